@@ -0,0 +1,274 @@
+#include "alloc_tracker.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#ifdef __linux__
+#include <malloc.h>
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct TrackerState {
+    bool active = false;
+    AllocationCounters counters;
+};
+
+thread_local TrackerState tracker;
+thread_local const char* allocationForbiddenIn = nullptr;
+
+#ifndef NDEBUG
+[[noreturn]] void forbiddenAllocation(std::size_t size) {
+    // No iostreams here: they could allocate and recurse.
+    std::fprintf(stderr, "Allocation of %zu bytes inside %s\n", size, allocationForbiddenIn);
+    std::abort();
+}
+#endif
+
+std::size_t usableSize(void* p) {
+#ifdef __linux__
+    return malloc_usable_size(p);
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+inline void noteAllocation(void* p, std::size_t size) {
+#ifndef NDEBUG
+    if (allocationForbiddenIn && p) forbiddenAllocation(size);
+#endif
+    if (!tracker.active || !p) return;
+    AllocationCounters& counters = tracker.counters;
+    ++counters.allocations;
+    counters.bytes += size;
+    counters.liveBytes += static_cast<int64_t>(usableSize(p));
+    counters.peakLiveBytes = std::max(counters.peakLiveBytes, counters.liveBytes);
+}
+
+inline void noteDeallocation(void* p) {
+    if (!tracker.active || !p) return;
+    ++tracker.counters.deallocations;
+    tracker.counters.liveBytes -= static_cast<int64_t>(usableSize(p));
+}
+
+} // namespace
+
+void AllocationCounters::merge(const AllocationCounters& other) {
+    allocations += other.allocations;
+    deallocations += other.deallocations;
+    bytes += other.bytes;
+    liveBytes += other.liveBytes;
+    peakLiveBytes = std::max(peakLiveBytes, other.peakLiveBytes);
+}
+
+bool allocationHooksInstalled() {
+#ifdef PINNACIUM_NO_ALLOCATION_HOOKS
+    return false;
+#elif defined(PINNACIUM_INTERPOSE_MALLOC) && !defined(__GLIBC__)
+    return false;
+#else
+    return true;
+#endif
+}
+
+void startAllocationTracking() {
+    tracker.counters = AllocationCounters{};
+    tracker.active = true;
+}
+
+AllocationCounters stopAllocationTracking() {
+    tracker.active = false;
+    return tracker.counters;
+}
+
+#ifndef NDEBUG
+NoAllocationScope::NoAllocationScope(const char* what) : previous_(allocationForbiddenIn) {
+    allocationForbiddenIn = what;
+}
+
+NoAllocationScope::~NoAllocationScope() {
+    allocationForbiddenIn = previous_;
+}
+#endif
+
+long long peakRssBytes() {
+#ifdef __linux__
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return static_cast<long long>(usage.ru_maxrss) * 1024;
+#endif
+    return 0;
+}
+
+#ifndef PINNACIUM_NO_ALLOCATION_HOOKS
+#ifdef PINNACIUM_INTERPOSE_MALLOC
+#ifdef __GLIBC__
+
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* p, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* p);
+
+void* malloc(std::size_t size) {
+    void* p = __libc_malloc(size);
+    noteAllocation(p, size);
+    return p;
+}
+
+void* calloc(std::size_t count, std::size_t size) {
+    void* p = __libc_calloc(count, size);
+    noteAllocation(p, count * size);
+    return p;
+}
+
+void* realloc(void* old, std::size_t size) {
+    noteDeallocation(old);
+    void* p = __libc_realloc(old, size);
+    noteAllocation(p, size);
+    return p;
+}
+
+void* memalign(std::size_t alignment, std::size_t size) {
+    void* p = __libc_memalign(alignment, size);
+    noteAllocation(p, size);
+    return p;
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** out, std::size_t alignment, std::size_t size) {
+    void* p = memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void free(void* p) {
+    noteDeallocation(p);
+    __libc_free(p);
+}
+} // extern "C"
+
+#endif // __GLIBC__
+#else
+
+namespace {
+
+void* allocate(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    noteAllocation(p, size);
+    return p;
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+    void* p = nullptr;
+    if (posix_memalign(&p, align, size ? size : 1) != 0) return nullptr;
+    noteAllocation(p, size);
+    return p;
+}
+
+void deallocate(void* p) {
+    noteDeallocation(p);
+    std::free(p);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    void* p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    void* p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* p = allocateAligned(size, alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    void* p = allocateAligned(size, alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+
+#endif // PINNACIUM_INTERPOSE_MALLOC
+#endif // PINNACIUM_NO_ALLOCATION_HOOKS
@@ -0,0 +1,46 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstdint>
+
+// Heap activity of one thread between startAllocationTracking() and stopAllocationTracking().
+// The global operator new/delete replacements in alloc_tracker.cpp feed it; building with
+// PINNACIUM_INTERPOSE_MALLOC hooks malloc/free instead (glibc), which also sees C allocations,
+// and PINNACIUM_NO_ALLOCATION_HOOKS leaves the allocator untouched.
+struct AllocationCounters {
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytes = 0;        // requested bytes
+    int64_t liveBytes = 0;     // usable bytes allocated minus freed; negative when other threads' blocks are freed
+    int64_t peakLiveBytes = 0; // high-water mark of liveBytes
+
+    void merge(const AllocationCounters& other);
+};
+
+bool allocationHooksInstalled();
+// Thread-local and lock-free; nesting is not supported.
+void startAllocationTracking();
+AllocationCounters stopAllocationTracking();
+// Peak resident set size of the process so far.
+long long peakRssBytes();
+
+// Debug builds (without NDEBUG) abort when the current thread allocates through the hooks while a
+// scope is open, naming what the scope guards; release builds compile it away. Scopes may nest.
+class NoAllocationScope {
+public:
+    explicit NoAllocationScope(const char* what);
+    ~NoAllocationScope();
+
+    NoAllocationScope(const NoAllocationScope&) = delete;
+    NoAllocationScope& operator=(const NoAllocationScope&) = delete;
+
+private:
+    const char* previous_;
+};
+
+#ifdef NDEBUG
+inline NoAllocationScope::NoAllocationScope(const char*) : previous_(nullptr) {}
+inline NoAllocationScope::~NoAllocationScope() {}
+#endif
+
+#endif // ALLOC_TRACKER_H
@@ -0,0 +1,142 @@
+#include "async_benchmark.h"
+
+#ifdef PINNACIUM_HAS_COROUTINES
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+void RunQueueExecutor::post(std::coroutine_handle<> handle) {
+    ready_.push_back(handle);
+}
+
+void RunQueueExecutor::abandon() {
+    ready_.clear();
+    running_.clear();
+}
+
+bool RunQueueExecutor::poll() {
+    if (ready_.empty()) return false;
+    running_.swap(ready_);
+    while (!running_.empty()) {
+        std::coroutine_handle<> handle = running_.front();
+        running_.pop_front();
+        handle.resume();
+    }
+    return true;
+}
+
+AsyncBenchmark::AsyncBenchmark(std::string name, AsyncFunction fn, int iterations, int warmup)
+    : BenchmarkCore(std::move(name), iterations, warmup), function_(std::move(fn)) {}
+
+void AsyncBenchmark::run() {
+    stalled_ = false;
+    {
+        InlineExecutor executor(executionPolicy_);
+        attachExecutor(executor);
+
+        Progress warmup;
+        warmup.total = warmup_;
+        if (!driveAll(warmup)) {
+            detachExecutor();
+            stalled_ = true;
+            std::cerr << "Async benchmark " << name_ << " failed during warm-up; not measured" << std::endl;
+            return;
+        }
+
+        waitAtStartBarrier();
+        beginMeasurement();
+        TelemetryReporter telemetry;
+        startTelemetry(telemetry);
+        Progress progress;
+        progress.total = iterations_;
+        progress.record = true;
+        const auto begin = std::chrono::steady_clock::now();
+        const bool completed = driveAll(progress);
+        seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        telemetry.stop();
+        if (!completed) {
+            detachExecutor();
+            stalled_ = true;
+            std::cerr << "Async benchmark " << name_ << " failed after " << progress.completed << " of "
+                      << progress.total << " operations; results discarded" << std::endl;
+            return;
+        }
+        finishMeasurement(progress.completed);
+        detachExecutor();
+    }
+    printResults();
+    exportResults();
+}
+
+void AsyncBenchmark::setConcurrency(int inFlight) {
+    concurrency_ = std::max(inFlight, 1);
+}
+
+void AsyncBenchmark::setExecutor(std::shared_ptr<AsyncExecutor> executor) {
+    if (executor) asyncExecutor_ = std::move(executor);
+}
+
+AsyncExecutor& AsyncBenchmark::executor() {
+    return *asyncExecutor_;
+}
+
+bool AsyncBenchmark::stalled() const {
+    return stalled_;
+}
+
+int AsyncBenchmark::concurrency() const {
+    return concurrency_;
+}
+
+double AsyncBenchmark::completionRate() const {
+    return seconds_ > 0.0 ? static_cast<double>(iterationsRun_) / seconds_ : 0.0;
+}
+
+void AsyncBenchmark::printWorkers() const {
+    std::cout << "Concurrency: " << concurrency_ << " in flight" << std::endl;
+    std::cout << "Completion Rate: " << completionRate() << " ops/s" << std::endl;
+}
+
+void AsyncBenchmark::addTableMetadata(ResultTable& table) const {
+    table.addMetadata("concurrency", std::to_string(concurrency_));
+    table.addMetadata("completion_rate", std::to_string(completionRate()));
+}
+
+// One issuing slot: every completion is recorded and immediately replaced by the next operation.
+template <typename Timer>
+AsyncTask AsyncBenchmark::drive(Progress& progress) {
+    const TimerCalibration& calibration = *calibration_;
+    while (progress.next < progress.total) {
+        const int iteration = progress.next++;
+        if (setupFunction_) setupFunction_();
+        uint64_t start = Timer::start();
+        co_await function_();
+        uint64_t end = Timer::stop();
+        if (teardownFunction_) teardownFunction_();
+        if (progress.record) recordOperation(0, iteration, calibration.toNs(end - start));
+        ++progress.completed;
+    }
+}
+
+bool AsyncBenchmark::driveAll(Progress& progress) {
+    const bool tsc = calibration_->kind == TimerKind::Tsc;
+    std::vector<AsyncTask> slots;
+    slots.reserve(static_cast<std::size_t>(concurrency_));
+    for (int slot = 0; slot < std::min(concurrency_, progress.total); ++slot) {
+        slots.push_back(tsc ? drive<TscTimer>(progress) : drive<ChronoTimer>(progress));
+        asyncExecutor_->post(slots.back().handle());
+    }
+    while (progress.completed < progress.total) {
+        if (!asyncExecutor_->poll()) {
+            std::cerr << "Async benchmark " << name_ << " stalled: " << progress.total - progress.completed
+                      << " operations never completed" << std::endl;
+            // The slots are destroyed on return; nothing may resume them afterwards.
+            asyncExecutor_->abandon();
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // PINNACIUM_HAS_COROUTINES
@@ -0,0 +1,206 @@
+#ifndef ASYNC_BENCHMARK_H
+#define ASYNC_BENCHMARK_H
+
+// Coroutine support needs C++20 (-std=c++20); in C++17 builds this header and async_benchmark.cpp
+// compile to nothing.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define PINNACIUM_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef PINNACIUM_HAS_COROUTINES
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "benchmark_core.h"
+
+// Lazily started coroutine returning nothing. Awaiting it starts it and resumes the awaiter when it
+// finishes (symmetric transfer, so chains of tasks do not grow the stack).
+class AsyncTask {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+
+        AsyncTask get_return_object() {
+            return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                return handle.promise().continuation;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    AsyncTask() = default;
+    AsyncTask(AsyncTask&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    AsyncTask& operator=(AsyncTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~AsyncTask() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool done() const {
+        return !handle_ || handle_.done();
+    }
+
+    // For executors starting a task that nobody awaits.
+    std::coroutine_handle<> handle() const {
+        return handle_;
+    }
+
+    bool await_ready() const noexcept {
+        return done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    explicit AsyncTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Where suspended operations are resumed. An I/O runtime plugs in by posting handles when their
+// events complete and polling its reactor from poll().
+class AsyncExecutor {
+public:
+    virtual ~AsyncExecutor() = default;
+
+    virtual void post(std::coroutine_handle<> handle) = 0;
+    // Resumes whatever is ready, waiting for events if the executor has any. Returns false when nothing
+    // is queued and nothing can become ready, so a run whose operations never complete stops instead of hanging.
+    virtual bool poll() = 0;
+    // Called after poll() returned false with operations still pending, just before their coroutines are
+    // destroyed: forget every handle still held (queued, or registered for events that may yet arrive),
+    // since resuming one afterwards would use freed frames.
+    virtual void abandon() {}
+
+    // co_await executor.schedule() suspends and requeues the awaiting coroutine.
+    auto schedule() {
+        struct Awaiter {
+            AsyncExecutor& executor;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                executor.post(handle);
+            }
+
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this};
+    }
+};
+
+// FIFO run queue on the calling thread; the default executor.
+class RunQueueExecutor : public AsyncExecutor {
+public:
+    void post(std::coroutine_handle<> handle) override;
+    // Resumes everything queued before the call.
+    bool poll() override;
+    void abandon() override;
+
+private:
+    std::deque<std::coroutine_handle<>> ready_;
+    std::deque<std::coroutine_handle<>> running_;
+};
+
+// Keeps concurrency operations in flight on one thread and times each from issue (the call that
+// creates it) to the resumption after it completes, into the same statistics, histogram and result
+// sinks as synchronous benchmarks. Setup and teardown run around every operation outside the timed
+// span; batching, convergence, counters and allocation tracking do not apply.
+class AsyncBenchmark : public BenchmarkCore {
+public:
+    using AsyncFunction = std::function<AsyncTask()>;
+
+    AsyncBenchmark(std::string name, AsyncFunction fn, int iterations = 100, int warmup = 10);
+
+    // Any callable returning an awaitable; it is wrapped in an AsyncTask.
+    template <typename F, typename = std::enable_if_t<!std::is_convertible_v<F, AsyncFunction>>>
+    AsyncBenchmark(std::string name, F fn, int iterations = 100, int warmup = 10)
+        : AsyncBenchmark(std::move(name), AsyncFunction([fn]() mutable -> AsyncTask { co_await fn(); }), iterations, warmup) {}
+
+    AsyncBenchmark(AsyncBenchmark&&) = default;
+    AsyncBenchmark& operator=(AsyncBenchmark&&) = default;
+
+    void run() override;
+    // Operations in flight at once; each completion issues the next one.
+    void setConcurrency(int inFlight);
+    // Defaults to a RunQueueExecutor.
+    void setExecutor(std::shared_ptr<AsyncExecutor> executor);
+    AsyncExecutor& executor();
+
+    // True when the last run() stopped because operations never completed; nothing was printed or
+    // exported, and the statistics do not describe that run.
+    bool stalled() const;
+    int concurrency() const;
+    // Completed operations per second of wall time over the timed phase.
+    double completionRate() const;
+
+protected:
+    void printWorkers() const override;
+    void addTableMetadata(ResultTable& table) const override;
+
+private:
+    struct Progress {
+        int next = 0;
+        int total = 0;
+        int completed = 0;
+        bool record = false;
+    };
+
+    template <typename Timer>
+    AsyncTask drive(Progress& progress);
+    bool driveAll(Progress& progress);
+
+    AsyncFunction function_;
+    std::shared_ptr<AsyncExecutor> asyncExecutor_ = std::make_shared<RunQueueExecutor>();
+    int concurrency_ = 1;
+    double seconds_ = 0.0;
+    bool stalled_ = false;
+};
+
+#endif // PINNACIUM_HAS_COROUTINES
+
+#endif // ASYNC_BENCHMARK_H
@@ -1,239 +1,357 @@
 #include "benchmark.h"
 
+namespace {
+
+struct FunctionKernel {
+    const Benchmark::BenchmarkFunction& function;
+    const Benchmark::BatchFunction& batch;
+    const Benchmark::BenchmarkFunction& setup;
+    const Benchmark::BenchmarkFunction& teardown;
+
+    void setUp() {
+        if (setup) setup();
+    }
+
+    void tearDown() {
+        if (teardown) teardown();
+    }
+
+    void call() {
+        function();
+    }
+
+    void callBatch(long long count) {
+        batch(count);
+    }
+};
+
+} // namespace
+
+Benchmark::Benchmark(std::string name, int iterations, int warmup)
+    : BenchmarkCore(std::move(name), iterations, warmup) {}
+
 Benchmark::Benchmark(std::string name, BenchmarkFunction fn, int iterations, int warmup)
-    : name_(std::move(name)), function_(std::move(fn)), iterations_(iterations), warmup_(warmup) {}
+    : BenchmarkCore(std::move(name), iterations, warmup), function_(std::move(fn)) {
+    batchFunction_ = [fn = function_](long long count) {
+        for (long long n = 0; n < count; ++n) {
+            fn();
+        }
+    };
+}
 
 void Benchmark::run() {
-    warmUp();
-    measure();
+    {
+        InlineExecutor executor(executionPolicy_);
+        attachExecutor(executor);
+        warmUp();
+        waitAtStartBarrier();
+        measure();
+        detachExecutor();
+    }
     printResults();
     exportResults();
 }
 
-void Benchmark::setSetupFunction(BenchmarkFunction setup) {
-    setupFunction_ = std::move(setup);
+void Benchmark::warmUp() {
+    FunctionKernel kernel{function_, batchFunction_, setupFunction_, teardownFunction_};
+    warmUpKernel(kernel);
 }
 
-void Benchmark::setTeardownFunction(BenchmarkFunction teardown) {
-    teardownFunction_ = std::move(teardown);
+void Benchmark::measure() {
+    FunctionKernel kernel{function_, batchFunction_, setupFunction_, teardownFunction_};
+    measureKernel(kernel);
 }
 
-void Benchmark::enablePerformanceCounters(bool enable) {
-    usePerformanceCounters_ = enable;
-}
+// Per-iteration hooks around the timed call; Call is chosen once in measure() so the timed region
+// makes a single direct call.
+template <typename Call>
+struct MultiThreadedBenchmark::IterationBody {
+    MultiThreadedBenchmark& benchmark;
+    Call function;
 
-void Benchmark::warmUp() {
-    for (int i = 0; i < warmup_; ++i) {
-        if (setupFunction_) setupFunction_();
-        function_();
-        if (teardownFunction_) teardownFunction_();
+    void setUp(int threadIndex) {
+        benchmark.setUpIteration(threadIndex);
     }
-}
 
-void Benchmark::measure() {
-    for (int i = 0; i < iterations_; ++i) {
-        if (setupFunction_) setupFunction_();
+    void tearDown(int threadIndex) {
+        benchmark.tearDownIteration(threadIndex);
+    }
 
-        auto start = std::chrono::high_resolution_clock::now();
-        if (usePerformanceCounters_) {
-            startPerfCounters();
-        }
-        function_();
-        if (usePerformanceCounters_) {
-            stopPerfCounters();
+    void call(int threadIndex) {
+        function(threadIndex);
+    }
+
+    void callBatch(int threadIndex, long long count) {
+        for (long long n = 0; n < count; ++n) {
+            function(threadIndex);
         }
-        auto end = std::chrono::high_resolution_clock::now();
+    }
+};
 
-        if (teardownFunction_) teardownFunction_();
+MultiThreadedBenchmark::MultiThreadedBenchmark(std::string name, BenchmarkFunction fn, int iterations, int warmup, int threads)
+    : BenchmarkCore(std::move(name), iterations, warmup, threads), function_(std::move(fn)) {}
 
-        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-        results_.push_back(duration);
+MultiThreadedBenchmark::MultiThreadedBenchmark(std::string name, std::shared_ptr<ThreadFixture> fixture, int iterations, int warmup, int threads)
+    : BenchmarkCore(std::move(name), iterations, warmup, threads), fixture_(std::move(fixture)) {}
+
+void MultiThreadedBenchmark::run() {
+    if (!threadSweep_.empty()) {
+        runSweep();
+        return;
     }
+    startPool(threads_);
+    runOnPool();
+    stopPool();
+    printResults();
+    exportResults();
 }
 
-void Benchmark::printResults() {
-    auto mean = std::accumulate(results_.begin(), results_.end(), 0LL) / results_.size();
-    auto variance = std::accumulate(results_.begin(), results_.end(), 0LL,
-        [mean](long long sum, long long value) {
-            return sum + (value - mean) * (value - mean);
-        }
-    ) / results_.size();
-
-    auto stddev = std::sqrt(variance);
+void MultiThreadedBenchmark::runSweep() {
+    const std::string baseName = name_;
+    const int baseThreads = threads_;
+    startPool(*std::max_element(threadSweep_.begin(), threadSweep_.end()));
+
+    scaling_.clear();
+    for (int count : threadSweep_) {
+        threads_ = count;
+        name_ = baseName + "/threads:" + std::to_string(count);
+        runOnPool();
+        printResults();
+        exportResults();
+
+        ScalingPoint point;
+        point.threads = count;
+        point.throughput = aggregateThroughput();
+        scaling_.push_back(point);
+    }
 
-    std::cout << "Benchmark: " << name_ << std::endl;
-    std::cout << "Iterations: " << iterations_ << std::endl;
-    std::cout << "Mean: " << mean << " ns" << std::endl;
-    std::cout << "Stddev: " << stddev << " ns" << std::endl;
-    std::cout << "Min: " << *std::min_element(results_.begin(), results_.end()) << " ns" << std::endl;
-    std::cout << "Max: " << *std::max_element(results_.begin(), results_.end()) << " ns" << std::endl;
+    stopPool();
+    name_ = baseName;
+    threads_ = baseThreads;
+    computeScaling(scaling_);
+    printScaling();
+    exportTable(scalingTable());
+}
 
-    if (usePerformanceCounters_) {
-        std::cout << "Performance Counters:" << std::endl;
-        for (const auto& counter : performanceCounters_) {
-            std::cout << "Counter Value: " << counter << std::endl;
-        }
+void MultiThreadedBenchmark::startPool(int threads) {
+    ExecutionPolicy policy = executionPolicy_;
+    policy.cpus = placeWorkers(threads);
+    pool_ = std::make_unique<ThreadPool>(threads, policy);
+    threadNodes_.assign(pool_->size(), -1);
+    for (int t = 0; t < pool_->size(); ++t) {
+        if (pool_->workerCpu(t) >= 0) threadNodes_[t] = numaTopology().nodeOfCpu(pool_->workerCpu(t));
     }
+    attachExecutor(*pool_);
+}
 
-    std::cout << "=========================" << std::endl;
+void MultiThreadedBenchmark::runOnPool() {
+    if (fixture_) fixture_->setUp(threads_);
+    pool_->run([this](int threadIndex) {
+        if (fixture_) fixture_->setUpThread(threadIndex, threads_);
+        if (threadSetupFunction_) threadSetupFunction_(threadIndex, threads_);
+    }, threads_);
+    warmUp();
+    waitAtStartBarrier();
+    measure();
+    pool_->run([this](int threadIndex) {
+        if (threadTeardownFunction_) threadTeardownFunction_(threadIndex, threads_);
+        if (fixture_) fixture_->tearDownThread(threadIndex, threads_);
+    }, threads_);
+    if (fixture_) fixture_->tearDown(threads_);
 }
 
-void Benchmark::exportResults() {
-    std::ofstream file(name_ + "_results.csv");
-    file << "Iteration,Duration (ns)";
-    if (usePerformanceCounters_) {
-        file << ",Performance Counter";
-    }
-    file << "\n";
-    for (size_t i = 0; i < results_.size(); ++i) {
-        file << i + 1 << "," << results_[i];
-        if (usePerformanceCounters_ && i < performanceCounters_.size()) {
-            file << "," << performanceCounters_[i];
-        }
-        file << "\n";
-    }
-    file.close();
-    std::cout << "Results exported to " << name_ << "_results.csv" << std::endl;
+void MultiThreadedBenchmark::stopPool() {
+    detachExecutor();
+    pool_.reset();
 }
 
-void Benchmark::startPerfCounters() {
-    unsigned int low, high;
-    __asm__ volatile (
-        "rdpmc\n\t"
-        "mov %%eax, %0\n\t"
-        "mov %%edx, %1\n\t"
-        : "=r" (low), "=r" (high)
-        :
-        : "%eax", "%edx"
-    );
-    prevCounter_ = ((uint64_t)high << 32) | low;
+void MultiThreadedBenchmark::pinThreads(bool enable) {
+    executionPolicy_.pin = enable;
 }
 
-void Benchmark::stopPerfCounters() {
-    uint64_t currentCounter;
-    __asm__ volatile ("rdpmc" : "=A" (currentCounter) : : "memory");
-    performanceCounters_.push_back(currentCounter - prevCounter_);
+void MultiThreadedBenchmark::enableThreadSweep() {
+    threadSweep_ = defaultThreadSweep(threads_);
 }
 
-MultiThreadedBenchmark::MultiThreadedBenchmark(std::string name, Benchmark::BenchmarkFunction fn, int iterations, int warmup, int threads)
-    : name_(std::move(name)), function_(std::move(fn)), iterations_(iterations), warmup_(warmup), threads_(threads) {}
+void MultiThreadedBenchmark::setThreadSweep(std::vector<int> threadCounts) {
+    threadSweep_.clear();
+    for (int count : threadCounts) {
+        if (count > 0) threadSweep_.push_back(count);
+    }
+}
 
-void MultiThreadedBenchmark::run() {
-    warmUp();
-    measure();
-    printResults();
-    exportResults();
+void MultiThreadedBenchmark::setPlacement(PlacementPolicy policy, int node) {
+    placement_ = policy;
+    placementNode_ = node;
+}
+
+void MultiThreadedBenchmark::setThreadSetupFunction(ThreadFunction setup) {
+    threadSetupFunction_ = std::move(setup);
+}
+
+void MultiThreadedBenchmark::setThreadTeardownFunction(ThreadFunction teardown) {
+    threadTeardownFunction_ = std::move(teardown);
 }
 
-void MultiThreadedBenchmark::setSetupFunction(Benchmark::BenchmarkFunction setup) {
-    setupFunction_ = std::move(setup);
+const std::vector<ScalingPoint>& MultiThreadedBenchmark::scaling() const {
+    return scaling_;
 }
 
-void MultiThreadedBenchmark::setTeardownFunction(Benchmark::BenchmarkFunction teardown) {
-    teardownFunction_ = std::move(teardown);
+void MultiThreadedBenchmark::setUpIteration(int threadIndex) {
+    if (fixture_) fixture_->setUpIteration(threadIndex, threads_);
+    if (setupFunction_) setupFunction_();
 }
 
-void MultiThreadedBenchmark::enablePerformanceCounters(bool enable) {
-    usePerformanceCounters_ = enable;
+void MultiThreadedBenchmark::tearDownIteration(int threadIndex) {
+    if (teardownFunction_) teardownFunction_();
+    if (fixture_) fixture_->tearDownIteration(threadIndex, threads_);
 }
 
 void MultiThreadedBenchmark::warmUp() {
-    for (int i = 0; i < warmup_; ++i) {
-        runInThreads([this] {
-            if (setupFunction_) setupFunction_();
-            function_();
-            if (teardownFunction_) teardownFunction_();
-        });
+    ThreadFixture* fixture = fixture_.get();
+    int threads = threads_;
+    if (fixture) {
+        auto call = [fixture, threads](int threadIndex) { fixture->run(threadIndex, threads); };
+        IterationBody<decltype(call)> body{*this, call};
+        warmUpBody(body);
+    } else {
+        auto call = [this](int) { function_(); };
+        IterationBody<decltype(call)> body{*this, call};
+        warmUpBody(body);
     }
 }
 
 void MultiThreadedBenchmark::measure() {
-    for (int i = 0; i < iterations_; ++i) {
-        runInThreads([this, i] {
-            if (setupFunction_) setupFunction_();
-
-            auto start = std::chrono::high_resolution_clock::now();
-            if (usePerformanceCounters_) {
-                startPerfCounters();
-            }
-            function_();
-            if (usePerformanceCounters_) {
-                stopPerfCounters();
-            }
-            auto end = std::chrono::high_resolution_clock::now();
-
-            if (teardownFunction_) teardownFunction_();
-
-            auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                results_.push_back(duration);
-            }
-        });
+    ThreadFixture* fixture = fixture_.get();
+    int threads = threads_;
+    if (fixture) {
+        auto call = [fixture, threads](int threadIndex) { fixture->run(threadIndex, threads); };
+        IterationBody<decltype(call)> body{*this, call};
+        measureBody(body);
+    } else {
+        auto call = [this](int) { function_(); };
+        IterationBody<decltype(call)> body{*this, call};
+        measureBody(body);
     }
 }
 
-void MultiThreadedBenchmark::runInThreads(const std::function<void()>& task) {
-    std::vector<std::thread> threadPool;
-    for (int t = 0; t < threads_; ++t) {
-        threadPool.emplace_back(task);
+double MultiThreadedBenchmark::aggregateThroughput() const {
+    if (throughputDuration_.count() > 0) return throughput_.opsPerSecond();
+    if (useOpenLoop_) return openLoop_.achievedRate();
+    const double batch = static_cast<double>(batchSize_);
+    if (samples_.empty()) {
+        // Without raw samples, assume every worker took the mean time per iteration.
+        double mean = stats_.running().mean();
+        return mean > 0.0 ? threads_ * batch * 1e9 / mean : 0.0;
     }
-    for (auto& th : threadPool) {
-        th.join();
+    // Workers start each iteration together, so the slowest one bounds its wall time.
+    std::vector<long long> wall(iterationsRun_, 0);
+    for (const auto& sample : samples_) {
+        long long& slowest = wall[sample.iteration];
+        slowest = std::max(slowest, sample.duration);
     }
+    long long total = std::accumulate(wall.begin(), wall.end(), 0LL);
+    return total > 0 ? static_cast<double>(samples_.size()) * batch * 1e9 / static_cast<double>(total) : 0.0;
 }
 
-void MultiThreadedBenchmark::printResults() {
-    auto mean = std::accumulate(results_.begin(), results_.end(), 0LL) / results_.size();
-    auto variance = std::accumulate(results_.begin(), results_.end(), 0LL,
-        [mean](long long sum, long long value) {
-            return sum + (value - mean) * (value - mean);
-        }
-    ) / results_.size();
-
-    auto stddev = std::sqrt(variance);
-
-    std::cout << "Benchmark: " << name_ << std::endl;
-    std::cout << "Iterations: " << iterations_ << std::endl;
-    std::cout << "Mean: " << mean << " ns" << std::endl;
-    std::cout << "Stddev: " << stddev << " ns" << std::endl;
-    std::cout << "Min: " << *std::min_element(results_.begin(), results_.end()) << " ns" << std::endl;
-    std::cout << "Max: " << *std::max_element(results_.begin(), results_.end()) << " ns" << std::endl;
+std::vector<int> MultiThreadedBenchmark::placeWorkers(int threads) const {
+    const NumaTopology& full = numaTopology();
+    NumaTopology topology = executionPolicy_.cpus.empty() ? full : full.restrictedTo(executionPolicy_.cpus);
+    std::vector<int> cpus = placeThreads(topology, placement_, threads, placementNode_);
+    if (cpus.empty() && placement_ == PlacementPolicy::PerNode) {
+        std::cerr << "No usable CPUs on NUMA node " << placementNode_ << "; using compact placement" << std::endl;
+        cpus = placeThreads(topology, PlacementPolicy::Compact, threads);
+    }
+    return cpus;
+}
 
-    if (usePerformanceCounters_) {
-        std::cout << "Performance Counters:" << std::endl;
-        for (const auto& counter : performanceCounters_) {
-            std::cout << "Counter Value: " << counter << std::endl;
+void MultiThreadedBenchmark::printWorkers() const {
+    std::cout << "Threads: " << threads_ << std::endl;
+    if (!startSkews_.empty()) {
+        auto meanSkew = std::accumulate(startSkews_.begin(), startSkews_.end(), 0LL) / static_cast<long long>(startSkews_.size());
+        std::cout << "Start Skew (mean): " << meanSkew << " ns" << std::endl;
+        std::cout << "Start Skew (max): " << *std::max_element(startSkews_.begin(), startSkews_.end()) << " ns" << std::endl;
+    }
+    std::vector<RunningStats> perThread(threads_);
+    for (const auto& sample : samples_) {
+        perThread[sample.threadIndex].add(static_cast<double>(sample.duration));
+    }
+    for (int t = 0; t < threads_; ++t) {
+        if (perThread[t].count()) {
+            std::cout << "Thread " << t << " Mean: " << perThread[t].mean() << " ns" << std::endl;
         }
     }
+    std::cout << "Placement: " << placementName(placement_) << " across " << numaTopology().nodes.size() << " NUMA node(s)" << std::endl;
+    std::map<int, std::pair<RunningStats, int>> perNode;
+    for (int t = 0; t < threads_; ++t) {
+        if (threadNodes_[t] < 0 || !perThread[t].count()) continue;
+        perNode[threadNodes_[t]].first.merge(perThread[t]);
+        ++perNode[threadNodes_[t]].second;
+    }
+    for (const auto& [node, entry] : perNode) {
+        std::cout << "Node " << node << " Mean: " << entry.first.mean() << " ns (" << entry.second << " threads)" << std::endl;
+    }
+}
 
-    std::cout << "=========================" << std::endl;
+void MultiThreadedBenchmark::addTableMetadata(ResultTable& table) const {
+    table.addMetadata("placement", placementName(placement_));
+    table.addMetadata("numa_nodes", std::to_string(numaTopology().nodes.size()));
 }
 
-void MultiThreadedBenchmark::exportResults() {
-    std::ofstream file(name_ + "_results.csv");
-    file << "Iteration,Duration (ns)";
-    if (usePerformanceCounters_) {
-        file << ",Performance Counter";
+void MultiThreadedBenchmark::addWorkerColumns(ResultTable& table) const {
+    size_t rows = samples_.size();
+    auto& thread = table.addIntColumn("Thread", rows);
+    for (const auto& sample : samples_) thread.ints.push_back(sample.threadIndex);
+    auto& skew = table.addIntColumn("Start Skew (ns)", rows);
+    for (const auto& sample : samples_) {
+        size_t index = static_cast<size_t>(sample.iteration);
+        skew.ints.push_back(index < startSkews_.size() ? startSkews_[index] : 0);
     }
-    file << "\n";
-    for (size_t i = 0; i < results_.size(); ++i) {
-        file << i + 1 << "," << results_[i];
-        if (usePerformanceCounters_ && i < performanceCounters_.size()) {
-            file << "," << performanceCounters_[i];
-        }
-        file << "\n";
+    auto& node = table.addIntColumn("Node", rows);
+    for (const auto& sample : samples_) {
+        size_t index = static_cast<size_t>(sample.threadIndex);
+        node.ints.push_back(index < threadNodes_.size() ? threadNodes_[index] : -1);
     }
-    file.close();
-    std::cout << "Results exported to " << name_ << "_results.csv" << std::endl;
 }
 
-void MultiThreadedBenchmark::startPerfCounters() {
-    __asm__ volatile ("rdpmc" : "=A" (prevCounter_) : : "memory");
+void MultiThreadedBenchmark::printScaling() const {
+    ScalingFit amdahl = fitAmdahl(scaling_);
+    ScalingFit usl = fitUsl(scaling_);
+
+    std::cout << "Scaling: " << name_ << std::endl;
+    std::cout << "Threads,Throughput (ops/s),Speedup,Efficiency,Serial Fraction" << std::endl;
+    for (const auto& point : scaling_) {
+        std::cout << point.threads << "," << point.throughput << "," << point.speedup << ","
+                  << point.efficiency << "," << point.serialFraction << std::endl;
+    }
+    std::cout << "Amdahl: sigma " << amdahl.sigma << " (rms " << amdahl.rms << ")" << std::endl;
+    std::cout << "USL: sigma " << usl.sigma << ", kappa " << usl.kappa << " (rms " << usl.rms << ")" << std::endl;
+    if (usl.kappa > 0.0) {
+        std::cout << "USL peak: " << std::sqrt((1.0 - usl.sigma) / usl.kappa) << " threads" << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
 }
 
-void MultiThreadedBenchmark::stopPerfCounters() {
-    uint64_t currentCounter;
-    __asm__ volatile ("rdpmc" : "=A" (currentCounter) : : "memory");
-    performanceCounters_.push_back(currentCounter - prevCounter_);
-}
\ No newline at end of file
+ResultTable MultiThreadedBenchmark::scalingTable() const {
+    ResultTable table;
+    table.name = name_ + "/scaling";
+    table.metadata = environment_.metadata();
+    ScalingFit amdahl = fitAmdahl(scaling_);
+    ScalingFit usl = fitUsl(scaling_);
+    table.addMetadata("amdahl_sigma", std::to_string(amdahl.sigma));
+    table.addMetadata("usl_sigma", std::to_string(usl.sigma));
+    table.addMetadata("usl_kappa", std::to_string(usl.kappa));
+
+    size_t rows = scaling_.size();
+    auto& threads = table.addIntColumn("Threads", rows);
+    for (const auto& point : scaling_) threads.ints.push_back(point.threads);
+    auto& throughput = table.addDoubleColumn("Throughput (ops/s)", rows);
+    for (const auto& point : scaling_) throughput.doubles.push_back(point.throughput);
+    auto& speedup = table.addDoubleColumn("Speedup", rows);
+    for (const auto& point : scaling_) speedup.doubles.push_back(point.speedup);
+    auto& efficiency = table.addDoubleColumn("Efficiency", rows);
+    for (const auto& point : scaling_) efficiency.doubles.push_back(point.efficiency);
+    auto& serial = table.addDoubleColumn("Serial Fraction", rows);
+    for (const auto& point : scaling_) serial.doubles.push_back(point.serialFraction);
+    return table;
+}
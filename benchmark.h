@@ -12,71 +12,201 @@
 #include <mutex>
 #include <fstream>
 #include <cmath>
-#include <immintrin.h> // For RDPMC (x86-specific)
+#include <memory>
+#include <type_traits>
+#include <map>
 
-class Benchmark {
+#include "benchmark_core.h"
+#include "numa.h"
+#include "scaling.h"
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    __asm__ volatile ("" : : "r,m" (value) : "memory");
+}
+
+template <typename T>
+inline void doNotOptimize(T& value) {
+    if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*)) {
+        __asm__ volatile ("" : "+r,m" (value) : : "memory");
+    } else {
+        __asm__ volatile ("" : "+m" (value) : : "memory");
+    }
+}
+
+inline void clobberMemory() {
+    __asm__ volatile ("" : : : "memory");
+}
+
+struct NoOp {
+    void operator()() const {}
+};
+
+// Callables stored by value; every call is direct so the compiler can inline the measured work.
+template <typename F, typename Setup = NoOp, typename Teardown = NoOp>
+struct DirectKernel {
+    F function;
+    Setup setup;
+    Teardown teardown;
+
+    void setUp() {
+        setup();
+    }
+
+    void tearDown() {
+        teardown();
+    }
+
+    void call() {
+        function();
+    }
+
+    void callBatch(long long count) {
+        for (long long n = 0; n < count; ++n) {
+            function();
+        }
+    }
+};
+
+// Single-threaded front end: the engine runs on one InlineExecutor worker, the calling thread,
+// which is pinned for the duration of run(); by default to the CPU it started on.
+class Benchmark : public BenchmarkCore {
 public:
-    using BenchmarkFunction = std::function<void()>;
+    using BatchFunction = std::function<void(long long)>;
 
     Benchmark(std::string name, BenchmarkFunction fn, int iterations = 100, int warmup = 10);
 
-    void run();
-    void setSetupFunction(BenchmarkFunction setup);
-    void setTeardownFunction(BenchmarkFunction teardown);
-    void enablePerformanceCounters(bool enable);
+    // Takes the callable by value so the batched inner loop calls it directly instead of through std::function.
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, BenchmarkFunction>>>
+    Benchmark(std::string name, F fn, int iterations = 100, int warmup = 10)
+        : Benchmark(std::move(name), BenchmarkFunction(fn), iterations, warmup) {
+        batchFunction_ = [fn](long long count) mutable {
+            for (long long n = 0; n < count; ++n) {
+                fn();
+            }
+        };
+    }
 
-private:
-    void warmUp();
-    void measure();
-    void printResults();
-    void exportResults();
+    Benchmark(Benchmark&&) = default;
+    Benchmark& operator=(Benchmark&&) = default;
+
+    void run() override;
 
-    void startPerfCounters();
-    void stopPerfCounters();
+protected:
+    Benchmark(std::string name, int iterations, int warmup);
 
-    std::string name_;
+    virtual void warmUp();
+    virtual void measure();
+    template <typename Kernel>
+    void warmUpKernel(Kernel& kernel);
+    template <typename Kernel>
+    void measureKernel(Kernel& kernel);
+
+private:
     BenchmarkFunction function_;
-    BenchmarkFunction setupFunction_;
-    BenchmarkFunction teardownFunction_;
-    int iterations_;
-    int warmup_;
-    bool usePerformanceCounters_ = false;
-    uint64_t prevCounter_ = 0;
-    std::vector<long long> results_;
-    std::vector<uint64_t> performanceCounters_;
+    BatchFunction batchFunction_;
 };
 
-class MultiThreadedBenchmark {
+template <typename Kernel>
+void Benchmark::warmUpKernel(Kernel& kernel) {
+    WorkerKernel<Kernel> body{kernel};
+    warmUpBody(body);
+}
+
+template <typename Kernel>
+void Benchmark::measureKernel(Kernel& kernel) {
+    WorkerKernel<Kernel> body{kernel};
+    measureBody(body);
+}
+
+// Zero-overhead front end: F, Setup and Teardown are called directly in the measurement loop.
+// Setup/teardown come from the template arguments; setSetupFunction/setTeardownFunction are not used.
+template <typename F, typename Setup = NoOp, typename Teardown = NoOp>
+class BasicBenchmark : public Benchmark {
 public:
-    MultiThreadedBenchmark(std::string name, Benchmark::BenchmarkFunction fn, int iterations = 100, int warmup = 10, int threads = std::thread::hardware_concurrency());
+    BasicBenchmark(std::string name, F fn, Setup setup = Setup(), Teardown teardown = Teardown(), int iterations = 100, int warmup = 10)
+        : Benchmark(std::move(name), iterations, warmup), kernel_{std::move(fn), std::move(setup), std::move(teardown)} {}
+
+protected:
+    void warmUp() override {
+        warmUpKernel(kernel_);
+    }
 
-    void run();
-    void setSetupFunction(Benchmark::BenchmarkFunction setup);
-    void setTeardownFunction(Benchmark::BenchmarkFunction teardown);
-    void enablePerformanceCounters(bool enable);
+    void measure() override {
+        measureKernel(kernel_);
+    }
 
 private:
+    DirectKernel<F, Setup, Teardown> kernel_;
+};
+
+template <typename F>
+BasicBenchmark<F> makeBenchmark(std::string name, F fn, int iterations = 100, int warmup = 10) {
+    return BasicBenchmark<F>(std::move(name), std::move(fn), NoOp(), NoOp(), iterations, warmup);
+}
+
+template <typename F, typename Setup, typename Teardown,
+          typename = std::enable_if_t<std::is_invocable_v<Setup&> && std::is_invocable_v<Teardown&>>>
+BasicBenchmark<F, Setup, Teardown> makeBenchmark(std::string name, F fn, Setup setup, Teardown teardown, int iterations = 100, int warmup = 10) {
+    return BasicBenchmark<F, Setup, Teardown>(std::move(name), std::move(fn), std::move(setup), std::move(teardown), iterations, warmup);
+}
+
+// Multi-threaded front end: the engine runs on a ThreadPool whose workers start every timed
+// iteration together and whose placement follows the NUMA policy.
+class MultiThreadedBenchmark : public BenchmarkCore {
+public:
+    using ThreadFunction = std::function<void(int threadIndex, int threadCount)>;
+
+    MultiThreadedBenchmark(std::string name, BenchmarkFunction fn, int iterations = 100, int warmup = 10, int threads = std::thread::hardware_concurrency());
+    // The fixture's run(threadIndex, threadCount) is the timed body; see ThreadFixture for the phase order.
+    MultiThreadedBenchmark(std::string name, std::shared_ptr<ThreadFixture> fixture, int iterations = 100, int warmup = 10, int threads = std::thread::hardware_concurrency());
+
+    void run() override;
+    void pinThreads(bool enable);
+    // Runs the benchmark once per thread count on one pool sized for the largest count, then reports
+    // throughput, speedup, efficiency and Amdahl/USL fits. The default sweep is 1, 2, 4, ... up to threads.
+    void enableThreadSweep();
+    void setThreadSweep(std::vector<int> threadCounts);
+    // Chooses worker CPUs across the NUMA nodes of the execution policy's CPU set. Defaults to Compact.
+    void setPlacement(PlacementPolicy policy, int node = 0);
+    // Run once on each worker after it is pinned, so first-touch allocations land on the worker's node.
+    void setThreadSetupFunction(ThreadFunction setup);
+    void setThreadTeardownFunction(ThreadFunction teardown);
+
+    const std::vector<ScalingPoint>& scaling() const;
+    ResultTable scalingTable() const;
+
+protected:
+    void printWorkers() const override;
+    void addTableMetadata(ResultTable& table) const override;
+    void addWorkerColumns(ResultTable& table) const override;
+
+private:
+    template <typename Call>
+    struct IterationBody;
+
+    void runSweep();
+    void startPool(int threads);
+    void runOnPool();
+    void stopPool();
+    double aggregateThroughput() const;
+    void printScaling() const;
     void warmUp();
     void measure();
-    void runInThreads(const std::function<void()>& task);
-    void printResults();
-    void exportResults();
-
-    void startPerfCounters();
-    void stopPerfCounters();
-
-    std::string name_;
-    Benchmark::BenchmarkFunction function_;
-    Benchmark::BenchmarkFunction setupFunction_;
-    Benchmark::BenchmarkFunction teardownFunction_;
-    int iterations_;
-    int warmup_;
-    int threads_;
-    bool usePerformanceCounters_ = false;
-    uint64_t prevCounter_ = 0;
-    std::vector<long long> results_;
-    std::vector<uint64_t> performanceCounters_;
-    std::mutex mutex_;
+    void setUpIteration(int threadIndex);
+    void tearDownIteration(int threadIndex);
+    std::vector<int> placeWorkers(int threads) const;
+
+    BenchmarkFunction function_;
+    std::shared_ptr<ThreadFixture> fixture_;
+    ThreadFunction threadSetupFunction_;
+    ThreadFunction threadTeardownFunction_;
+    PlacementPolicy placement_ = PlacementPolicy::Compact;
+    int placementNode_ = 0;
+    std::vector<int> threadNodes_; // NUMA node of each worker, -1 when unpinned
+    std::vector<int> threadSweep_;
+    std::vector<ScalingPoint> scaling_;
+    std::unique_ptr<ThreadPool> pool_;
 };
 
 #endif // BENCHMARK_H
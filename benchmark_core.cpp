@@ -0,0 +1,671 @@
+#include "benchmark_core.h"
+
+#include <iostream>
+
+namespace {
+
+void printCounterSummary(const std::vector<std::string>& events, const std::vector<uint64_t>& totals, uint64_t samples) {
+    if (samples == 0 || totals.size() != events.size()) return;
+
+    std::cout << "Performance Counters (mean per iteration):" << std::endl;
+    std::vector<double> means(events.size(), 0.0);
+    double cycles = -1.0;
+    double instructions = -1.0;
+    for (size_t e = 0; e < events.size(); ++e) {
+        means[e] = static_cast<double>(totals[e]) / static_cast<double>(samples);
+        std::cout << events[e] << ": " << means[e] << std::endl;
+        if (events[e] == "cycles") cycles = means[e];
+        if (events[e] == "instructions") instructions = means[e];
+    }
+    if (cycles > 0.0 && instructions >= 0.0) {
+        std::cout << "IPC: " << instructions / cycles << std::endl;
+    }
+    if (instructions > 0.0) {
+        const std::string suffix = "-misses";
+        for (size_t e = 0; e < events.size(); ++e) {
+            const std::string& event = events[e];
+            if (event.size() > suffix.size() && event.compare(event.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                std::cout << event << " MPKI: " << means[e] * 1000.0 / instructions << std::endl;
+            }
+        }
+    }
+}
+
+void printSummary(const StatsSummary& summary) {
+    std::cout << "Mean: " << summary.mean << " ns" << std::endl;
+    std::cout << "Stddev: " << summary.stddev << " ns" << std::endl;
+    std::cout << "Min: " << summary.min << " ns" << std::endl;
+    std::cout << "Max: " << summary.max << " ns" << std::endl;
+    std::cout << "P50: " << summary.p50 << " ns" << std::endl;
+    std::cout << "P90: " << summary.p90 << " ns" << std::endl;
+    std::cout << "P99: " << summary.p99 << " ns" << std::endl;
+    std::cout << "P99.9: " << summary.p999 << " ns" << std::endl;
+    std::cout << "P99.99: " << summary.p9999 << " ns" << std::endl;
+    std::cout << "Quantiles: " << (summary.exactQuantiles ? "exact" : "approximate (histogram)") << std::endl;
+    if (summary.exactQuantiles) {
+        const OutlierSummary& outliers = summary.outliers;
+        std::cout << "Outliers (Tukey): " << outliers.low() << " low (" << outliers.lowSevere << " severe), "
+                  << outliers.high() << " high (" << outliers.highSevere << " severe)" << std::endl;
+        std::cout << "Outliers (MAD): " << outliers.madLow << " low, " << outliers.madHigh << " high" << std::endl;
+    }
+}
+
+void printCpus(const EnvironmentReport& environment) {
+    std::cout << "CPUs: " << formatCpuList(environment.cpus) << (environment.pinned ? " (pinned)" : "")
+              << (environment.realtime ? " SCHED_FIFO" : "") << std::endl;
+}
+
+void printAllocations(const AllocationCounters& total, double operations, long long peakRss) {
+    if (!allocationHooksInstalled()) {
+        std::cout << "Allocations: not tracked (built without allocation hooks)" << std::endl;
+        return;
+    }
+    if (operations > 0.0) {
+        std::cout << "Allocations/op: " << static_cast<double>(total.allocations) / operations << std::endl;
+        std::cout << "Bytes/op: " << static_cast<double>(total.bytes) / operations << std::endl;
+    }
+    std::cout << "Peak Live Bytes (per iteration): " << total.peakLiveBytes << std::endl;
+    std::cout << "Peak RSS: " << peakRss << " bytes" << std::endl;
+}
+
+void addCounterColumns(ResultTable& table, const std::vector<std::string>& events, const std::vector<uint64_t>& values, size_t rows) {
+    size_t eventCount = events.size();
+    if (eventCount == 0 || values.size() < rows * eventCount) return;
+    for (size_t e = 0; e < eventCount; ++e) {
+        auto& column = table.addIntColumn(events[e], rows);
+        for (size_t i = 0; i < rows; ++i) {
+            column.ints.push_back(static_cast<int64_t>(values[i * eventCount + e]));
+        }
+    }
+}
+
+void addThroughputTable(ResultTable& table, const ThroughputResult& result) {
+    table.addMetadata("mode", "throughput");
+    table.addMetadata("ops_per_second", std::to_string(result.opsPerSecond()));
+    if (result.bytesPerOp > 0) {
+        table.addMetadata("bytes_per_op", std::to_string(result.bytesPerOp));
+        table.addMetadata("bytes_per_second", std::to_string(result.bytesPerSecond()));
+    }
+    if (result.itemsPerOp > 0) {
+        table.addMetadata("items_per_op", std::to_string(result.itemsPerOp));
+        table.addMetadata("items_per_second", std::to_string(result.itemsPerSecond()));
+    }
+
+    size_t rows = result.workers.size();
+    auto& thread = table.addIntColumn("Thread", rows);
+    for (size_t t = 0; t < rows; ++t) thread.ints.push_back(static_cast<int64_t>(t));
+    auto& operations = table.addIntColumn("Operations", rows);
+    for (const auto& worker : result.workers) operations.ints.push_back(worker.operations);
+    auto& elapsed = table.addIntColumn("Elapsed (ns)", rows);
+    for (const auto& worker : result.workers) elapsed.ints.push_back(worker.elapsedNs);
+}
+
+void addOpenLoopTable(ResultTable& table, const OpenLoopOptions& options, const OpenLoopResult& result) {
+    table.addMetadata("mode", "open-loop");
+    table.addMetadata("schedule", arrivalScheduleName(options.schedule));
+    table.addMetadata("target_rate", std::to_string(options.rate));
+    table.addMetadata("achieved_rate", std::to_string(result.achievedRate()));
+    table.addMetadata("operations", std::to_string(result.operations));
+    table.addMetadata("late", std::to_string(result.late));
+
+    // Both histograms share one bucket layout, so each row is one bucket.
+    std::vector<size_t> buckets;
+    for (size_t i = 0; i < result.latency.bucketCount(); ++i) {
+        if (result.latency.countAt(i) || result.serviceTime.countAt(i)) buckets.push_back(i);
+    }
+    auto& low = table.addIntColumn("Bucket Low (ns)", buckets.size());
+    for (size_t i : buckets) low.ints.push_back(static_cast<int64_t>(result.latency.bucketLow(i)));
+    auto& high = table.addIntColumn("Bucket High (ns)", buckets.size());
+    for (size_t i : buckets) high.ints.push_back(static_cast<int64_t>(result.latency.bucketHigh(i)));
+    auto& latency = table.addIntColumn("Latency Count", buckets.size());
+    for (size_t i : buckets) latency.ints.push_back(static_cast<int64_t>(result.latency.countAt(i)));
+    auto& service = table.addIntColumn("Service Time Count", buckets.size());
+    for (size_t i : buckets) service.ints.push_back(static_cast<int64_t>(result.serviceTime.countAt(i)));
+}
+
+void addHistogramTable(ResultTable& table, const Histogram& histogram) {
+    std::vector<size_t> buckets;
+    for (size_t i = 0; i < histogram.bucketCount(); ++i) {
+        if (histogram.countAt(i)) buckets.push_back(i);
+    }
+    auto& low = table.addIntColumn("Bucket Low (ns)", buckets.size());
+    for (size_t i : buckets) low.ints.push_back(static_cast<int64_t>(histogram.bucketLow(i)));
+    auto& high = table.addIntColumn("Bucket High (ns)", buckets.size());
+    for (size_t i : buckets) high.ints.push_back(static_cast<int64_t>(histogram.bucketHigh(i)));
+    auto& count = table.addIntColumn("Count", buckets.size());
+    for (size_t i : buckets) count.ints.push_back(static_cast<int64_t>(histogram.countAt(i)));
+}
+
+} // namespace
+
+BenchmarkCore::BenchmarkCore(std::string name, int iterations, int warmup, int threads)
+    : name_(std::move(name)), iterations_(iterations), warmup_(warmup), threads_(std::max(threads, 1)) {}
+
+void BenchmarkCore::setSetupFunction(BenchmarkFunction setup) {
+    setupFunction_ = std::move(setup);
+}
+
+void BenchmarkCore::setTeardownFunction(BenchmarkFunction teardown) {
+    teardownFunction_ = std::move(teardown);
+}
+
+void BenchmarkCore::enablePerformanceCounters(bool enable) {
+    usePerformanceCounters_ = enable;
+}
+
+void BenchmarkCore::setPerformanceEvents(std::vector<std::string> events) {
+    performanceEvents_ = std::move(events);
+}
+
+void BenchmarkCore::enableTopDown(bool enable) {
+    useTopDown_ = enable;
+}
+
+const TopDownBreakdown& BenchmarkCore::topDown() const {
+    return topDown_;
+}
+
+void BenchmarkCore::setTimer(TimerKind kind) {
+    timerKind_ = kind;
+}
+
+void BenchmarkCore::enableBatching(bool enable) {
+    useBatching_ = enable;
+}
+
+void BenchmarkCore::setBatchTarget(std::chrono::nanoseconds target) {
+    batchTarget_ = target;
+}
+
+void BenchmarkCore::keepRawSamples(bool keep) {
+    keepSamples_ = keep;
+}
+
+void BenchmarkCore::enableConvergence(double relativeWidth, std::chrono::nanoseconds timeBudget) {
+    useConvergence_ = true;
+    targetRelativeWidth_ = relativeWidth;
+    timeBudget_ = timeBudget;
+}
+
+void BenchmarkCore::setExecutionPolicy(ExecutionPolicy policy) {
+    executionPolicy_ = std::move(policy);
+}
+
+void BenchmarkCore::enableThroughputMode(std::chrono::nanoseconds duration) {
+    throughputDuration_ = duration;
+}
+
+void BenchmarkCore::setBytesPerOp(long long bytes) {
+    throughput_.bytesPerOp = bytes;
+}
+
+void BenchmarkCore::setItemsPerOp(long long items) {
+    throughput_.itemsPerOp = items;
+}
+
+void BenchmarkCore::enableOpenLoop(OpenLoopOptions options) {
+    openLoopOptions_ = options;
+    useOpenLoop_ = true;
+}
+
+void BenchmarkCore::setCacheState(CacheState state) {
+    cacheControl_.setState(state);
+}
+
+CacheController& BenchmarkCore::cacheControl() {
+    return cacheControl_;
+}
+
+void BenchmarkCore::trackAllocations(bool enable) {
+    trackAllocations_ = enable;
+}
+
+void BenchmarkCore::setStartBarrier(std::function<void()> barrier) {
+    startBarrier_ = std::move(barrier);
+}
+
+void BenchmarkCore::addTelemetrySink(std::shared_ptr<TelemetrySink> sink) {
+    if (sink) telemetrySinks_.push_back(std::move(sink));
+}
+
+void BenchmarkCore::setTelemetryOptions(TelemetryOptions options) {
+    telemetryOptions_ = options;
+}
+
+void BenchmarkCore::setResultSink(std::shared_ptr<ResultSink> sink) {
+    resultSink_ = std::move(sink);
+}
+
+void BenchmarkCore::setResultFormat(ResultFormat format, std::string directory) {
+    resultSink_ = makeResultSink(format, std::move(directory));
+}
+
+const std::string& BenchmarkCore::name() const {
+    return name_;
+}
+
+const SampleStats& BenchmarkCore::stats() const {
+    return stats_;
+}
+
+const std::vector<Sample>& BenchmarkCore::samples() const {
+    return samples_;
+}
+
+long long BenchmarkCore::batchSize() const {
+    return batchSize_;
+}
+
+double BenchmarkCore::measuredSeconds() const {
+    return measuredSeconds_;
+}
+
+int BenchmarkCore::threads() const {
+    return threads_;
+}
+
+const EnvironmentReport& BenchmarkCore::environment() const {
+    return environment_;
+}
+
+const ThroughputResult& BenchmarkCore::throughput() const {
+    return throughput_;
+}
+
+const OpenLoopResult& BenchmarkCore::openLoop() const {
+    return openLoop_;
+}
+
+void BenchmarkCore::attachExecutor(Executor& executor) {
+    executor_ = &executor;
+    calibration_ = &timerCalibration(timerKind_);
+    workers_.clear();
+    workers_.resize(executor.size());
+
+    std::vector<int> cpus;
+    for (int t = 0; t < executor.size(); ++t) {
+        if (executor.workerCpu(t) >= 0) cpus.push_back(executor.workerCpu(t));
+    }
+    bool pinned = static_cast<int>(cpus.size()) == executor.size();
+    if (cpus.empty()) cpus = executionPolicy_.cpus.empty() ? allowedCpus() : executionPolicy_.cpus;
+    environment_ = inspectEnvironment(cpus);
+    environment_.pinned = pinned;
+    environment_.realtime = executor.realtime();
+    printEnvironmentWarnings(environment_);
+    if (executor.size() > 1 && executionPolicy_.realtime && !environment_.realtime) {
+        std::cerr << "Failed to enable SCHED_FIFO on all workers (needs CAP_SYS_NICE or RLIMIT_RTPRIO)" << std::endl;
+    }
+    if (usePerformanceCounters_) openPerfCounters();
+    if (useTopDown_) openTopDownCounters();
+}
+
+void BenchmarkCore::detachExecutor() {
+    for (auto& worker : workers_) {
+        worker.counters.reset();
+        worker.topDown.reset();
+    }
+    executor_ = nullptr;
+}
+
+void BenchmarkCore::beginMeasurement() {
+    if (useConvergence_) keepSamples_ = true;
+    size_t eventCount = usePerformanceCounters_ ? performanceEvents_.size() : 0;
+    for (int t = 0; t < threads_; ++t) {
+        WorkerState& worker = workers_[t];
+        worker.stats = SampleStats(false);
+        worker.rows = ThreadSampleBuffer();
+        worker.allocationTotal = AllocationCounters{};
+        worker.counterTotals.assign(eventCount, 0);
+        worker.counterScratch.assign(eventCount, 0);
+        // Never reset: the reporter publishes differences, so counts can keep growing across phases.
+        if (!telemetrySinks_.empty() && !worker.live) worker.live = std::make_unique<LiveHistogram>();
+    }
+    iterationsRun_ = 0;
+    startSkews_.clear();
+    startSkews_.reserve(iterations_);
+    sampleArena_.release();
+    reserveRows(static_cast<size_t>(iterations_));
+    stats_ = SampleStats(keepSamples_);
+    samples_.clear();
+    performanceCounters_.clear();
+    counterTotals_.assign(eventCount, 0);
+    allocations_.clear();
+    allocationTotal_ = AllocationCounters{};
+    throughput_.workers.clear();
+    openLoop_.clear();
+    measuredSeconds_ = 0.0;
+    measureStart_ = std::chrono::steady_clock::now();
+}
+
+void BenchmarkCore::startTelemetry(TelemetryReporter& reporter) {
+    if (telemetrySinks_.empty()) return;
+    std::vector<const LiveHistogram*> sources;
+    for (int t = 0; t < threads_; ++t) sources.push_back(workers_[t].live.get());
+    reporter.start(name_, std::move(sources), telemetryOptions_, telemetrySinks_);
+}
+
+void BenchmarkCore::recordOperation(int threadIndex, int iteration, long long durationNs) {
+    recordSample(workers_[threadIndex], threadIndex, iteration, durationNs, AllocationCounters{});
+}
+
+void BenchmarkCore::finishMeasurement(int iterations) {
+    iterationsRun_ = iterations;
+    measuredSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - measureStart_).count();
+    collectSamples();
+}
+
+void BenchmarkCore::reserveRows(std::size_t rows) {
+    if (startSkews_.capacity() < rows) startSkews_.reserve(rows);
+    if (!keepSamples_ || (sampleArena_.data() && workers_[0].rows.capacity() >= rows)) return;
+
+    const std::size_t capacity = std::max(rows, workers_[0].rows.capacity() * 2);
+    const std::size_t eventCount = usePerformanceCounters_ ? performanceEvents_.size() : 0;
+    const std::size_t slice = ThreadSampleBuffer::bytesFor(capacity, eventCount, trackAllocations_);
+    SampleArena arena;
+    if (!arena.reserve(slice * static_cast<std::size_t>(threads_))) {
+        std::cerr << "Sample storage unavailable: " << arena.error() << "; " << name_
+                  << " keeps streaming statistics only" << std::endl;
+        fallBackToStreaming();
+        return;
+    }
+    // Each worker faults in its own slice, then takes over what it recorded so far.
+    const Executor::Task place = [&](int threadIndex) {
+        arena.prefault(slice * threadIndex, slice);
+        ThreadSampleBuffer moved;
+        moved.attach(arena.data() + slice * threadIndex, capacity, eventCount, trackAllocations_);
+        moved.copyFrom(workers_[threadIndex].rows);
+        workers_[threadIndex].rows = moved;
+    };
+    if (executor_) {
+        executor_->run(place, threads_);
+    } else {
+        for (int t = 0; t < threads_; ++t) place(t);
+    }
+    sampleArena_ = std::move(arena);
+}
+
+// Rows recorded so far are folded into each worker's streaming stats; their per-sample counter values
+// and allocations are dropped, the totals are already accumulated.
+void BenchmarkCore::fallBackToStreaming() {
+    for (int t = 0; t < threads_; ++t) {
+        WorkerState& worker = workers_[t];
+        for (const Sample& sample : worker.rows) worker.stats.add(sample.duration);
+        worker.rows = ThreadSampleBuffer();
+    }
+    sampleArena_.release();
+    keepSamples_ = false;
+    if (useConvergence_) {
+        std::cerr << "Convergence disabled for " << name_ << ": it needs raw samples" << std::endl;
+        useConvergence_ = false;
+    }
+}
+
+void BenchmarkCore::recordSample(WorkerState& worker, int threadIndex, int iteration, long long duration,
+                                 const AllocationCounters& allocations) {
+    if (keepSamples_) {
+        worker.rows.record(threadIndex, iteration, duration, &allocations);
+    } else {
+        worker.stats.add(duration);
+    }
+    if (worker.live) worker.live->record(static_cast<uint64_t>(std::max(duration, 0LL) / batchSize_), batchSize_);
+    if (trackAllocations_) worker.allocationTotal.merge(allocations);
+}
+
+void BenchmarkCore::stopPerfCounters(WorkerState& worker) {
+    uint64_t* values = keepSamples_ ? worker.rows.counterSlot() : worker.counterScratch.data();
+    worker.counters->stop(values);
+    for (size_t e = 0; e < worker.counterTotals.size(); ++e) {
+        worker.counterTotals[e] += values[e];
+    }
+}
+
+void BenchmarkCore::collectStats() {
+    stats_ = SampleStats(keepSamples_);
+    if (!keepSamples_) {
+        for (int t = 0; t < threads_; ++t) stats_.merge(workers_[t].stats);
+        return;
+    }
+    std::size_t total = 0;
+    for (int t = 0; t < threads_; ++t) total += workers_[t].rows.size();
+    stats_.reserve(total);
+    for (int t = 0; t < threads_; ++t) {
+        for (const Sample& sample : workers_[t].rows) stats_.add(sample.duration);
+    }
+}
+
+void BenchmarkCore::collectSamples() {
+    collectStats();
+    for (int t = 0; t < threads_; ++t) {
+        const WorkerState& worker = workers_[t];
+        allocationTotal_.merge(worker.allocationTotal);
+        for (size_t e = 0; e < worker.counterTotals.size(); ++e) {
+            counterTotals_[e] += worker.counterTotals[e];
+        }
+    }
+    if (!keepSamples_) return;
+
+    struct Entry {
+        const Sample* sample;
+        const uint64_t* counters;
+        size_t counterCount;
+        const AllocationCounters* allocations;
+    };
+
+    std::vector<Entry> entries;
+    for (int t = 0; t < threads_; ++t) {
+        const WorkerState& worker = workers_[t];
+        for (size_t j = 0; j < worker.rows.size(); ++j) {
+            entries.push_back({worker.rows.begin() + j, worker.rows.counters(j), worker.rows.counterCount(), worker.rows.allocations(j)});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.sample->iteration != b.sample->iteration) return a.sample->iteration < b.sample->iteration;
+        return a.sample->threadIndex < b.sample->threadIndex;
+    });
+
+    samples_.reserve(entries.size());
+    for (const auto& entry : entries) {
+        samples_.push_back(*entry.sample);
+        performanceCounters_.insert(performanceCounters_.end(), entry.counters, entry.counters + entry.counterCount);
+        if (entry.allocations) allocations_.push_back(*entry.allocations);
+    }
+}
+
+bool BenchmarkCore::checkConvergence() {
+    collectStats();
+    medianInterval_ = bootstrapMedianCI(stats_.samples(), 0.95, 1000, 0x5eed, executor_);
+    converged_ = medianInterval_.relativeWidth() <= targetRelativeWidth_;
+    return converged_;
+}
+
+void BenchmarkCore::openPerfCounters() {
+    executor_->run([this](int threadIndex) {
+        workers_[threadIndex].counters = std::make_unique<PerfCounters>(performanceEvents_);
+        workers_[threadIndex].counters->open();
+    }, executor_->size());
+    for (auto& worker : workers_) {
+        if (!worker.counters->isOpen()) {
+            std::cerr << "Performance counters disabled: " << worker.counters->error() << std::endl;
+            for (auto& other : workers_) other.counters.reset();
+            usePerformanceCounters_ = false;
+            return;
+        }
+    }
+}
+
+void BenchmarkCore::openTopDownCounters() {
+    const TopDownModel* model = topDownModel();
+    if (!model) {
+        std::cerr << "Top-down analysis disabled: no event model for this CPU" << std::endl;
+        useTopDown_ = false;
+        return;
+    }
+    executor_->run([this, model](int threadIndex) {
+        workers_[threadIndex].topDown = std::make_unique<TopDownCounters>(*model);
+        workers_[threadIndex].topDown->open();
+    }, executor_->size());
+    for (auto& worker : workers_) {
+        if (!worker.topDown->error().empty()) {
+            std::cerr << "Top-down analysis disabled: " << worker.topDown->error() << std::endl;
+            for (auto& other : workers_) other.topDown.reset();
+            useTopDown_ = false;
+            return;
+        }
+    }
+}
+
+void BenchmarkCore::collectTopDown() {
+    const TopDownModel& model = *topDownModel();
+    std::vector<std::vector<uint64_t>> totals;
+    for (const auto& events : model.groups) totals.emplace_back(events.size(), 0);
+    std::vector<uint64_t> repetitions(model.groups.size(), 0);
+    for (int t = 0; t < threads_; ++t) {
+        TopDownCounters& counters = *workers_[t].topDown;
+        for (std::size_t g = 0; g < totals.size(); ++g) {
+            for (std::size_t e = 0; e < totals[g].size(); ++e) totals[g][e] += counters.totals()[g][e];
+            repetitions[g] += counters.repetitions()[g];
+        }
+        counters.clear();
+    }
+    topDown_ = computeTopDown(model, totals, repetitions);
+}
+
+void BenchmarkCore::waitAtStartBarrier() {
+    if (startBarrier_) startBarrier_();
+}
+
+void BenchmarkCore::printResults() {
+    std::cout << "Benchmark: " << name_ << std::endl;
+    if (throughputDuration_.count() > 0) {
+        if (threads_ > 1) std::cout << "Threads: " << threads_ << std::endl;
+        printThroughput(throughput_);
+        if (threads_ > 1) {
+            for (int t = 0; t < threads_; ++t) {
+                const ThroughputResult::Worker& worker = throughput_.workers[t];
+                double seconds = static_cast<double>(worker.elapsedNs) * 1e-9;
+                std::cout << "Thread " << t << " Throughput: " << (seconds > 0.0 ? worker.operations / seconds : 0.0) << " ops/s" << std::endl;
+            }
+        }
+        if (useBatching_) std::cout << "Batch Size: " << batchSize_ << std::endl;
+        printCpus(environment_);
+        std::cout << "=========================" << std::endl;
+        return;
+    }
+    if (useOpenLoop_) {
+        if (threads_ > 1) std::cout << "Threads: " << threads_ << std::endl;
+        printOpenLoop(openLoopOptions_, openLoop_);
+        printCpus(environment_);
+        std::cout << "=========================" << std::endl;
+        return;
+    }
+
+    StatsSummary summary = stats_.summarize();
+
+    std::cout << "Iterations: " << iterationsRun_ << std::endl;
+    printSummary(summary);
+    if (useConvergence_) {
+        std::cout << "Median 95% CI: [" << medianInterval_.lower << ", " << medianInterval_.upper << "] ns ("
+                  << medianInterval_.relativeWidth() * 100.0 << "% of median)" << std::endl;
+        std::cout << "Converged: " << (converged_ ? "yes" : "no (time budget exhausted)") << std::endl;
+    }
+    std::cout << "Timer: " << timerName(calibration_->kind) << " (overhead " << calibration_->overheadNs() << " ns subtracted)" << std::endl;
+    printCpus(environment_);
+    if (cacheControl_.active()) std::cout << "Cache: " << cacheControl_.describe() << std::endl;
+    if (useBatching_) {
+        double perOp = summary.mean / static_cast<double>(batchSize_);
+        std::cout << "Batch Size: " << batchSize_ << std::endl;
+        std::cout << "Per-Op: " << perOp << " ns" << std::endl;
+        std::cout << "Throughput: " << (perOp > 0.0 ? 1e9 / perOp : 0.0) << " ops/s" << std::endl;
+    }
+    printWorkers();
+    if (trackAllocations_) {
+        double operations = static_cast<double>(stats_.count()) * static_cast<double>(batchSize_);
+        printAllocations(allocationTotal_, operations, peakRss_);
+    }
+    if (usePerformanceCounters_) {
+        printCounterSummary(performanceEvents_, counterTotals_, stats_.count());
+    }
+    if (useTopDown_) printTopDown(topDown_);
+
+    std::cout << "=========================" << std::endl;
+}
+
+ResultTable BenchmarkCore::resultTable() const {
+    ResultTable table;
+    table.name = name_;
+    table.metadata = environment_.metadata();
+    const TimerCalibration& calibration = timerCalibration(timerKind_);
+    table.addMetadata("timer", timerName(calibration.kind));
+    table.addMetadata("timer_overhead_ns", std::to_string(calibration.overheadNs()));
+    addTableMetadata(table);
+    for (auto& [key, value] : cacheControl_.metadata()) table.addMetadata(key, value);
+    if (sampleArena_.data()) {
+        table.addMetadata("sample_arena_bytes", std::to_string(sampleArena_.size()));
+        table.addMetadata("sample_arena_pages", arenaBackingName(sampleArena_.backing()));
+    }
+    if (trackAllocations_) {
+        table.addMetadata("allocations", std::to_string(allocationTotal_.allocations));
+        table.addMetadata("allocated_bytes", std::to_string(allocationTotal_.bytes));
+        table.addMetadata("peak_live_bytes", std::to_string(allocationTotal_.peakLiveBytes));
+        table.addMetadata("peak_rss_bytes", std::to_string(peakRss_));
+    }
+    if (useTopDown_ && topDown_.valid) {
+        const std::pair<const char*, double> fractions[] = {
+            {"topdown_frontend_bound", topDown_.frontendBound}, {"topdown_bad_speculation", topDown_.badSpeculation},
+            {"topdown_backend_bound", topDown_.backendBound},   {"topdown_retiring", topDown_.retiring},
+            {"topdown_memory_bound", topDown_.memoryBound},     {"topdown_core_bound", topDown_.coreBound},
+        };
+        table.addMetadata("topdown_model", topDown_.model);
+        for (const auto& [key, value] : fractions) table.addMetadata(key, std::to_string(value));
+    }
+    if (throughputDuration_.count() > 0) {
+        addThroughputTable(table, throughput_);
+        return table;
+    }
+    if (useOpenLoop_) {
+        addOpenLoopTable(table, openLoopOptions_, openLoop_);
+        return table;
+    }
+    if (!keepSamples_) {
+        addHistogramTable(table, stats_.histogram());
+        return table;
+    }
+
+    size_t rows = samples_.size();
+    auto& iteration = table.addIntColumn("Iteration", rows);
+    for (const auto& sample : samples_) iteration.ints.push_back(sample.iteration + 1);
+    addWorkerColumns(table);
+    auto& duration = table.addIntColumn("Duration (ns)", rows);
+    for (const auto& sample : samples_) duration.ints.push_back(sample.duration);
+    if (useBatching_) {
+        table.addIntColumn("Batch Size").ints.assign(rows, batchSize_);
+        auto& perOp = table.addDoubleColumn("Per-Op (ns)", rows);
+        for (const auto& sample : samples_) {
+            perOp.doubles.push_back(static_cast<double>(sample.duration) / static_cast<double>(batchSize_));
+        }
+    }
+    if (trackAllocations_ && allocations_.size() == rows) {
+        auto& allocations = table.addIntColumn("Allocations", rows);
+        for (const auto& counters : allocations_) allocations.ints.push_back(static_cast<int64_t>(counters.allocations));
+        auto& bytes = table.addIntColumn("Allocated Bytes", rows);
+        for (const auto& counters : allocations_) bytes.ints.push_back(static_cast<int64_t>(counters.bytes));
+        auto& peak = table.addIntColumn("Peak Live Bytes", rows);
+        for (const auto& counters : allocations_) peak.ints.push_back(counters.peakLiveBytes);
+    }
+    if (usePerformanceCounters_) {
+        addCounterColumns(table, performanceEvents_, performanceCounters_, rows);
+    }
+    return table;
+}
+
+void BenchmarkCore::exportResults() {
+    exportTable(resultTable());
+}
+
+void BenchmarkCore::exportTable(const ResultTable& table) {
+    if (resultSink_->write(table)) {
+        std::cout << "Results exported to " << resultSink_->path(table) << std::endl;
+    } else {
+        std::cerr << "Failed to export results: " << resultSink_->error() << std::endl;
+    }
+}
@@ -0,0 +1,472 @@
+#ifndef BENCHMARK_CORE_H
+#define BENCHMARK_CORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "cache_control.h"
+#include "environment.h"
+#include "fixture.h"
+#include "open_loop.h"
+#include "perf_counters.h"
+#include "result_sink.h"
+#include "sample_arena.h"
+#include "sample_buffer.h"
+#include "stats.h"
+#include "telemetry.h"
+#include "thread_pool.h"
+#include "throughput.h"
+#include "timer.h"
+#include "topdown.h"
+
+// Adapts a kernel without a worker index (DirectKernel and friends) to the engine's Body interface:
+// setUp(t), tearDown(t), call(t) and callBatch(t, count) for worker t.
+template <typename Kernel>
+struct WorkerKernel {
+    Kernel& kernel;
+
+    void setUp(int) {
+        kernel.setUp();
+    }
+
+    void tearDown(int) {
+        kernel.tearDown();
+    }
+
+    void call(int) {
+        kernel.call();
+    }
+
+    void callBatch(int, long long count) {
+        kernel.callBatch(count);
+    }
+};
+
+// The measurement engine shared by Benchmark and MultiThreadedBenchmark. Every phase runs on an
+// Executor, so a single-threaded run is the same loop on one inline worker. The timer is a template
+// policy (TscTimer or ChronoTimer), counters, allocation tracking and cache preparation are per-worker
+// hooks, statistics stream into per-worker SampleStats merged after the run, and output goes through
+// the ResultSink.
+class BenchmarkCore {
+public:
+    using BenchmarkFunction = std::function<void()>;
+
+    virtual ~BenchmarkCore() = default;
+    BenchmarkCore(BenchmarkCore&&) = default;
+    BenchmarkCore& operator=(BenchmarkCore&&) = default;
+
+    virtual void run() = 0;
+
+    // Run before and after every timed call on each worker (once per batch when batching).
+    void setSetupFunction(BenchmarkFunction setup);
+    void setTeardownFunction(BenchmarkFunction teardown);
+    void enablePerformanceCounters(bool enable);
+    void setPerformanceEvents(std::vector<std::string> events);
+    // Level-1/2 top-down breakdown: the model's event groups take turns, one group per timed call, so
+    // none is multiplexed. Needs a CPU with a TopDownModel; samples mode only.
+    void enableTopDown(bool enable);
+    const TopDownBreakdown& topDown() const;
+    void setTimer(TimerKind kind);
+    // Times batches of calls instead of single calls; the batch is sized on worker 0.
+    void enableBatching(bool enable);
+    void setBatchTarget(std::chrono::nanoseconds target);
+    // Without raw samples only streaming stats and the histogram are kept; quantiles become approximate.
+    void keepRawSamples(bool keep);
+    // Treats iterations as a minimum and keeps measuring until the 95% bootstrap CI of the median is
+    // narrower than relativeWidth of the median, or timeBudget is spent. Forces raw samples on.
+    void enableConvergence(double relativeWidth = 0.01, std::chrono::nanoseconds timeBudget = std::chrono::seconds(10));
+    void setExecutionPolicy(ExecutionPolicy policy);
+    // Every worker calls the function back to back until a shared stop flag is set after duration,
+    // counting its ops locally, and ops/s is reported. Setup and teardown run once per worker around
+    // the window; counters and convergence are ignored.
+    void enableThroughputMode(std::chrono::nanoseconds duration = std::chrono::seconds(5));
+    void setBytesPerOp(long long bytes);
+    void setItemsPerOp(long long items);
+    // Open-loop load: every worker issues at rate / threads on the given schedule and records latency from
+    // each operation's intended start, so stalls are charged to every operation queued behind them.
+    void enableOpenLoop(OpenLoopOptions options);
+    // Cache, branch predictor and TLB preparation runs after setup and outside the timed region,
+    // once per timed call (once per batch when batching). Buffers to flush are registered on cacheControl().
+    void setCacheState(CacheState state);
+    CacheController& cacheControl();
+    // Counts heap allocations made inside the timed region (thread-local, through the global
+    // operator new/delete hooks) and records the process's peak RSS.
+    void trackAllocations(bool enable);
+
+    // Called on the driving thread after warm-up and right before every timed phase, e.g. to line the
+    // start up with other processes (see DistributedWorker).
+    void setStartBarrier(std::function<void()> barrier);
+    // While a timed phase runs, a reporter thread publishes ops/s and latency quantiles over the last
+    // window to every sink, reading per-worker live histograms without locking the workers.
+    void addTelemetrySink(std::shared_ptr<TelemetrySink> sink);
+    void setTelemetryOptions(TelemetryOptions options);
+
+    // Defaults to a CsvSink in the working directory.
+    void setResultSink(std::shared_ptr<ResultSink> sink);
+    void setResultFormat(ResultFormat format, std::string directory = ".");
+
+    const std::string& name() const;
+    const SampleStats& stats() const;
+    // Kept samples ordered by iteration, then worker; empty without raw samples.
+    const std::vector<Sample>& samples() const;
+    long long batchSize() const;
+    // Wall time of the last timed phase, from the end of its setup to its last sample; excludes warm-up
+    // but includes per-iteration setup, teardown, cache preparation and start barriers.
+    double measuredSeconds() const;
+    int threads() const;
+    const EnvironmentReport& environment() const;
+    const ThroughputResult& throughput() const;
+    const OpenLoopResult& openLoop() const;
+    ResultTable resultTable() const;
+
+protected:
+    static constexpr long long kMaxBatchSize = 1LL << 30;
+    static constexpr int kMaxIterations = 10000000;
+    static constexpr int kSizingRuns = 5; // timed batches per sizing step
+
+    // Recording state owned by one worker; merged by collectSamples() once the run is over.
+    struct alignas(64) WorkerState {
+        SampleStats stats;       // streaming only, when samples are not kept
+        ThreadSampleBuffer rows; // kept samples with their counter values and allocations, in sampleArena_
+        AllocationCounters allocationTotal;
+        std::vector<uint64_t> counterTotals;
+        std::vector<uint64_t> counterScratch; // counter values when rows are not kept
+        std::unique_ptr<PerfCounters> counters;
+        std::unique_ptr<TopDownCounters> topDown;
+        std::unique_ptr<LiveHistogram> live; // only with telemetry sinks
+    };
+
+    BenchmarkCore(std::string name, int iterations, int warmup, int threads = 1);
+
+    // Places the run on executor: inspects the environment of its workers and opens their counters.
+    void attachExecutor(Executor& executor);
+    void detachExecutor();
+
+    template <typename Body>
+    void warmUpBody(Body& body);
+    template <typename Body>
+    void measureBody(Body& body);
+
+    // For front ends that time operations themselves (AsyncBenchmark): beginMeasurement() resets the
+    // recording state, recordOperation() stores one timed operation for worker threadIndex, and
+    // finishMeasurement() merges the workers as measure() does.
+    void beginMeasurement();
+    void startTelemetry(TelemetryReporter& reporter);
+    void recordOperation(int threadIndex, int iteration, long long durationNs);
+    void finishMeasurement(int iterations);
+
+    void waitAtStartBarrier();
+    void printResults();
+    void exportResults();
+    void exportTable(const ResultTable& table);
+
+    // Hooks for the multi-threaded front end.
+    virtual void printWorkers() const {}
+    virtual void addTableMetadata(ResultTable&) const {}
+    virtual void addWorkerColumns(ResultTable&) const {}
+
+    std::string name_;
+    BenchmarkFunction setupFunction_;
+    BenchmarkFunction teardownFunction_;
+    int iterations_;
+    int warmup_;
+    int threads_; // active workers
+    ExecutionPolicy executionPolicy_;
+    EnvironmentReport environment_;
+    TimerKind timerKind_ = TimerKind::Tsc;
+    const TimerCalibration* calibration_ = nullptr;
+    std::chrono::nanoseconds throughputDuration_{0};
+    bool useOpenLoop_ = false;
+    long long batchSize_ = 1;
+    int iterationsRun_ = 0;
+    std::vector<long long> startSkews_; // one per timed iteration
+    std::vector<Sample> samples_;
+    SampleStats stats_;
+    ThroughputResult throughput_;
+    OpenLoopResult openLoop_;
+    CacheController cacheControl_;
+
+private:
+    template <typename Timer, typename Body>
+    void measureSamples(Body& body);
+    template <typename Timer, typename Body>
+    long long sizeBatch(Body& body);
+    template <typename Body>
+    void measureThroughput(Body& body);
+    template <typename Timer, typename Body>
+    void measureOpenLoop(Body& body);
+
+    // Moves every worker's rows into a fresh prefaulted arena holding at least rows records each;
+    // only between timed iterations. When no arena can be mapped the benchmark falls back to streaming
+    // statistics (keepSamples_ and convergence off) instead of recording past the rows' capacity.
+    void reserveRows(std::size_t rows);
+    void fallBackToStreaming();
+    void recordSample(WorkerState& worker, int threadIndex, int iteration, long long duration, const AllocationCounters& allocations);
+    void collectStats();
+    void collectSamples();
+    bool checkConvergence();
+
+    void openPerfCounters();
+    void openTopDownCounters();
+    void collectTopDown();
+    void stopPerfCounters(WorkerState& worker);
+
+    bool useBatching_ = false;
+    std::chrono::nanoseconds batchTarget_ = std::chrono::microseconds(10);
+    bool keepSamples_ = true;
+    bool useConvergence_ = false;
+    double targetRelativeWidth_ = 0.01;
+    std::chrono::nanoseconds timeBudget_ = std::chrono::seconds(10);
+    ConfidenceInterval medianInterval_;
+    bool converged_ = false;
+    bool usePerformanceCounters_ = false;
+    bool useTopDown_ = false;
+    TopDownBreakdown topDown_;
+    std::vector<std::string> performanceEvents_ = PerfCounters::defaultEvents();
+    OpenLoopOptions openLoopOptions_;
+    bool trackAllocations_ = false;
+    long long peakRss_ = 0;
+    std::chrono::steady_clock::time_point measureStart_;
+    double measuredSeconds_ = 0.0;
+    std::function<void()> startBarrier_;
+    std::vector<std::shared_ptr<TelemetrySink>> telemetrySinks_;
+    TelemetryOptions telemetryOptions_;
+    Executor* executor_ = nullptr;
+    std::vector<WorkerState> workers_;
+    SampleArena sampleArena_; // every worker's rows, one slice each
+    std::vector<uint64_t> performanceCounters_;    // samples x events, row-major
+    std::vector<uint64_t> counterTotals_;          // per event, over all timed calls
+    std::vector<AllocationCounters> allocations_;  // parallel to samples_
+    AllocationCounters allocationTotal_;
+    std::shared_ptr<ResultSink> resultSink_ = std::make_shared<CsvSink>();
+};
+
+template <typename Body>
+void BenchmarkCore::warmUpBody(Body& body) {
+    const Executor::Task task = [this, &body](int threadIndex) {
+        body.setUp(threadIndex);
+        executor_->startTogether(threadIndex);
+        body.call(threadIndex);
+        body.tearDown(threadIndex);
+    };
+    for (int i = 0; i < warmup_; ++i) {
+        executor_->run(task, threads_);
+    }
+}
+
+template <typename Body>
+void BenchmarkCore::measureBody(Body& body) {
+    beginMeasurement();
+    TelemetryReporter telemetry;
+    startTelemetry(telemetry);
+    const bool tsc = calibration_->kind == TimerKind::Tsc;
+    if (throughputDuration_.count() > 0) {
+        measureThroughput(body);
+    } else if (useOpenLoop_) {
+        tsc ? measureOpenLoop<TscTimer>(body) : measureOpenLoop<ChronoTimer>(body);
+    } else {
+        tsc ? measureSamples<TscTimer>(body) : measureSamples<ChronoTimer>(body);
+        telemetry.stop();
+        measuredSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - measureStart_).count();
+        collectSamples();
+        if (useTopDown_) collectTopDown();
+    }
+    telemetry.stop();
+    if (measuredSeconds_ == 0.0) {
+        measuredSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - measureStart_).count();
+    }
+    if (trackAllocations_) peakRss_ = peakRssBytes();
+}
+
+template <typename Timer, typename Body>
+void BenchmarkCore::measureSamples(Body& body) {
+    const TimerCalibration& calibration = *calibration_;
+    batchSize_ = useBatching_ ? sizeBatch<Timer>(body) : 1;
+    converged_ = false;
+    const auto deadline = std::chrono::steady_clock::now() + timeBudget_;
+    const bool prepareCaches = cacheControl_.active();
+
+    int iteration = 0;
+    const Executor::Task task = [&](int threadIndex) {
+        WorkerState& worker = workers_[threadIndex];
+        body.setUp(threadIndex);
+        if (prepareCaches) cacheControl_.prepare();
+        executor_->startTogether(threadIndex);
+        if (useTopDown_) worker.topDown->begin(iteration);
+        if (usePerformanceCounters_) worker.counters->start();
+        if (trackAllocations_) startAllocationTracking();
+
+        uint64_t start = Timer::start();
+        if (useBatching_) {
+            body.callBatch(threadIndex, batchSize_);
+        } else {
+            body.call(threadIndex);
+        }
+        uint64_t end = Timer::stop();
+
+        AllocationCounters allocations;
+        {
+            NoAllocationScope recording("the measurement loop");
+            if (trackAllocations_) allocations = stopAllocationTracking();
+            if (usePerformanceCounters_) stopPerfCounters(worker);
+            if (useTopDown_) worker.topDown->end();
+        }
+        body.tearDown(threadIndex);
+
+        NoAllocationScope recording("the measurement loop");
+        recordSample(worker, threadIndex, iteration, calibration.toNs(end - start), allocations);
+    };
+
+    int nextCheck = iterations_;
+    for (;; ++iteration) {
+        if (iteration >= nextCheck) {
+            if (!useConvergence_ || checkConvergence() || iteration >= kMaxIterations) break;
+            nextCheck = iteration + std::max(iteration / 4, 10);
+            reserveRows(static_cast<std::size_t>(nextCheck));
+        }
+        if (useConvergence_ && std::chrono::steady_clock::now() >= deadline) break;
+
+        executor_->run(task, threads_);
+        NoAllocationScope recording("the measurement loop");
+        startSkews_.push_back(executor_->lastStartSkew());
+    }
+    iterationsRun_ = iteration;
+    if (useConvergence_ && !converged_) checkConvergence();
+}
+
+// Grows the batch until the median of kSizingRuns timed batches on worker 0 reaches batchTarget_,
+// scaling by the observed shortfall (at most 10x per step). Each step first runs one untimed batch of
+// the new size, so cold caches and a single interrupted batch cannot settle the size.
+template <typename Timer, typename Body>
+long long BenchmarkCore::sizeBatch(Body& body) {
+    const TimerCalibration& calibration = *calibration_;
+    const double target = static_cast<double>(batchTarget_.count());
+    long long batch = 1;
+    bool timed = false;
+    double elapsed = 0.0;
+    const Executor::Task task = [&](int threadIndex) {
+        body.setUp(threadIndex);
+        uint64_t start = Timer::start();
+        body.callBatch(threadIndex, batch);
+        uint64_t end = Timer::stop();
+        body.tearDown(threadIndex);
+        if (timed) elapsed = static_cast<double>(calibration.toNs(end - start));
+    };
+    double runs[kSizingRuns];
+    while (batch < kMaxBatchSize) {
+        timed = false;
+        executor_->run(task, 1);
+        timed = true;
+        for (double& run : runs) {
+            executor_->run(task, 1);
+            run = elapsed;
+        }
+        std::nth_element(runs, runs + kSizingRuns / 2, runs + kSizingRuns);
+        const double median = runs[kSizingRuns / 2];
+        if (median >= target) break;
+
+        double multiplier = median > target / 10.0 ? target * 1.4 / median : 10.0;
+        long long next = static_cast<long long>(static_cast<double>(batch) * std::min(multiplier, 10.0));
+        batch = std::min(std::max(next, batch + 1), kMaxBatchSize);
+    }
+    return batch;
+}
+
+template <typename Body>
+void BenchmarkCore::measureThroughput(Body& body) {
+    batchSize_ = 1;
+    if (useBatching_) {
+        batchSize_ = calibration_->kind == TimerKind::Tsc ? sizeBatch<TscTimer>(body) : sizeBatch<ChronoTimer>(body);
+    }
+    throughput_.workers.assign(threads_, ThroughputResult::Worker{});
+
+    std::atomic<bool> stop{false};
+    std::unique_ptr<StopTimer> timer;
+    executor_->run([&](int threadIndex) {
+        body.setUp(threadIndex);
+        if (cacheControl_.active()) cacheControl_.prepare();
+        executor_->startTogether(threadIndex);
+        if (threadIndex == 0) timer = std::make_unique<StopTimer>(stop, throughputDuration_);
+
+        LiveHistogram* live = workers_[threadIndex].live.get();
+        long long operations = 0;
+        const auto begin = std::chrono::steady_clock::now();
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (useBatching_) {
+                body.callBatch(threadIndex, batchSize_);
+                operations += batchSize_;
+                if (live) live->addOperations(batchSize_);
+            } else {
+                body.call(threadIndex);
+                ++operations;
+                if (live) live->addOperations(1);
+            }
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        body.tearDown(threadIndex);
+        ThroughputResult::Worker& worker = throughput_.workers[threadIndex];
+        worker.operations = operations;
+        worker.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    }, threads_);
+    timer.reset();
+}
+
+template <typename Timer, typename Body>
+void BenchmarkCore::measureOpenLoop(Body& body) {
+    // Waits longer than this sleep first and spin only for the remainder.
+    constexpr double kSpinWindowNs = 200000.0;
+    constexpr double kLateNs = 1000.0;
+
+    const TimerCalibration& calibration = *calibration_;
+    const double durationNs = static_cast<double>(openLoopOptions_.duration.count());
+    PerThread<OpenLoopResult> results(threads_);
+    executor_->run([&](int threadIndex) {
+        OpenLoopResult& result = results.emplace(threadIndex);
+        LiveHistogram* live = workers_[threadIndex].live.get();
+        const double rate = openLoopOptions_.rate / threads_;
+        const double offsetNs = openLoopOptions_.schedule == ArrivalSchedule::Fixed && rate > 0.0 ? 1e9 / rate * threadIndex / threads_ : 0.0;
+        ArrivalClock clock(openLoopOptions_.schedule, rate, openLoopOptions_.seed + threadIndex, offsetNs);
+        body.setUp(threadIndex);
+        if (cacheControl_.active()) cacheControl_.prepare();
+        executor_->startTogether(threadIndex);
+
+        const uint64_t origin = Timer::start();
+        for (double intendedNs = clock.next(); intendedNs < durationNs; intendedNs = clock.next()) {
+            uint64_t intended = origin + static_cast<uint64_t>(intendedNs / calibration.nsPerTick);
+            uint64_t now = Timer::start();
+            if (now < intended) {
+                double aheadNs = static_cast<double>(intended - now) * calibration.nsPerTick;
+                if (aheadNs > kSpinWindowNs) {
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<long long>(aheadNs - kSpinWindowNs)));
+                }
+                while ((now = Timer::start()) < intended) cpuRelax();
+            }
+
+            body.call(threadIndex);
+            uint64_t end = Timer::stop();
+
+            result.latency.record(calibration.toNs(end - intended));
+            if (live) live->record(calibration.toNs(end - intended));
+            result.serviceTime.record(calibration.toNs(end - now));
+            if (static_cast<double>(now - intended) * calibration.nsPerTick > kLateNs) ++result.late;
+            ++result.operations;
+        }
+        result.seconds = static_cast<double>(Timer::stop() - origin) * calibration.nsPerTick * 1e-9;
+        body.tearDown(threadIndex);
+    }, threads_);
+
+    for (int t = 0; t < threads_; ++t) {
+        openLoop_.merge(results[t]);
+    }
+}
+
+#endif // BENCHMARK_CORE_H
@@ -0,0 +1,201 @@
+#include "cache_control.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // For _mm_clflush/_mm_mfence
+#endif
+
+namespace {
+
+constexpr std::size_t kCacheLine = 64;
+constexpr std::size_t kPageSize = 4096;
+constexpr std::size_t kDefaultLlcSize = 32u << 20;
+constexpr std::size_t kTlbPages = 8192;
+constexpr int kBranchRounds = 1 << 16;
+
+// Sink for values computed only to touch memory, so the reads cannot be removed.
+std::atomic<uint64_t> touchSink{0};
+
+std::size_t parseCacheSize(const std::string& text) {
+    std::size_t value = 0;
+    std::size_t i = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+        value = value * 10 + static_cast<std::size_t>(text[i++] - '0');
+    }
+    if (i < text.size() && (text[i] == 'K' || text[i] == 'k')) value <<= 10;
+    if (i < text.size() && (text[i] == 'M' || text[i] == 'm')) value <<= 20;
+    return value;
+}
+
+uint64_t branchA(uint64_t x) {
+    return x * 3 + 1;
+}
+
+uint64_t branchB(uint64_t x) {
+    return x ^ (x >> 7);
+}
+
+uint64_t branchC(uint64_t x) {
+    return x + 0x9e3779b97f4a7c15ULL;
+}
+
+uint64_t branchD(uint64_t x) {
+    return (x << 5) | (x >> 59);
+}
+
+} // namespace
+
+const char* cacheStateName(CacheState state) {
+    switch (state) {
+    case CacheState::Warm:
+        return "warm";
+    case CacheState::FlushBuffers:
+        return "cold (clflush)";
+    case CacheState::EvictLlc:
+        return "cold (LLC eviction)";
+    }
+    return "unknown";
+}
+
+std::size_t lastLevelCacheSize() {
+    static const std::size_t size = [] {
+        std::size_t largest = 0;
+        for (int index = 0; index < 8; ++index) {
+            std::ifstream file("/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/size");
+            std::string text;
+            if (!std::getline(file, text)) continue;
+            largest = std::max(largest, parseCacheSize(text));
+        }
+        return largest ? largest : kDefaultLlcSize;
+    }();
+    return size;
+}
+
+void CacheController::setState(CacheState state) {
+    state_ = state;
+#if defined(__x86_64__) || defined(__i386__)
+    bool needsSweep = state_ == CacheState::EvictLlc;
+#else
+    bool needsSweep = state_ != CacheState::Warm;
+#endif
+    if (needsSweep && evictionBuffer_.empty()) {
+        evictionBuffer_.assign(lastLevelCacheSize() * 2, 1);
+    }
+}
+
+void CacheController::registerBuffer(const void* data, std::size_t bytes) {
+    buffers_.push_back({static_cast<const unsigned char*>(data), bytes});
+}
+
+void CacheController::clearBuffers() {
+    buffers_.clear();
+}
+
+void CacheController::scrambleBranchPredictor(bool enable) {
+    scrambleBranches_ = enable;
+}
+
+void CacheController::scrambleTlb(bool enable) {
+    scrambleTlb_ = enable;
+    if (scrambleTlb_ && tlbBuffer_.empty()) {
+        tlbBuffer_.assign(kTlbPages * kPageSize, 1);
+    }
+}
+
+bool CacheController::active() const {
+    return state_ != CacheState::Warm || scrambleBranches_ || scrambleTlb_;
+}
+
+CacheState CacheController::state() const {
+    return state_;
+}
+
+std::string CacheController::describe() const {
+    std::string text = cacheStateName(state_);
+    if (state_ == CacheState::FlushBuffers) {
+        std::size_t bytes = 0;
+        for (const auto& buffer : buffers_) bytes += buffer.second;
+        text += ", " + std::to_string(buffers_.size()) + " buffer(s), " + std::to_string(bytes) + " bytes";
+    }
+    if (state_ == CacheState::EvictLlc) {
+        text += ", " + std::to_string(evictionBuffer_.size() >> 20) + " MiB sweep";
+    }
+    if (scrambleBranches_) text += ", branch predictor scrambled";
+    if (scrambleTlb_) text += ", TLB scrambled";
+    return text;
+}
+
+std::vector<std::pair<std::string, std::string>> CacheController::metadata() const {
+    return {
+        {"cache_state", cacheStateName(state_)},
+        {"branch_scramble", scrambleBranches_ ? "yes" : "no"},
+        {"tlb_scramble", scrambleTlb_ ? "yes" : "no"},
+    };
+}
+
+void CacheController::prepare() const {
+    if (scrambleTlb_) touchPages();
+    if (scrambleBranches_) scrambleBranches();
+    // Cache state last, so the eviction sweep also removes lines the scrambling pulled in.
+    if (state_ == CacheState::FlushBuffers) flushBuffers();
+    if (state_ == CacheState::EvictLlc) evict();
+}
+
+void CacheController::flushBuffers() const {
+#if defined(__x86_64__) || defined(__i386__)
+    for (const auto& [data, bytes] : buffers_) {
+        uintptr_t first = reinterpret_cast<uintptr_t>(data) & ~(kCacheLine - 1);
+        uintptr_t last = reinterpret_cast<uintptr_t>(data) + bytes;
+        for (uintptr_t line = first; line < last; line += kCacheLine) {
+            _mm_clflush(reinterpret_cast<const void*>(line));
+        }
+    }
+    _mm_mfence();
+#else
+    // No portable flush instruction; evicting the whole hierarchy has the same effect on the buffers.
+    evict();
+#endif
+}
+
+void CacheController::evict() const {
+    uint64_t sum = 0;
+    const unsigned char* data = evictionBuffer_.data();
+    for (std::size_t i = 0; i < evictionBuffer_.size(); i += kCacheLine) {
+        sum += data[i];
+    }
+    touchSink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+void CacheController::touchPages() const {
+    uint64_t sum = 0;
+    const unsigned char* data = tlbBuffer_.data();
+    // Page order is permuted by a stride coprime with the page count so the walk defeats the prefetchers.
+    std::size_t page = 0;
+    for (std::size_t i = 0; i < kTlbPages; ++i) {
+        sum += data[page * kPageSize + (i % (kPageSize / kCacheLine)) * kCacheLine];
+        page = (page + 4099) % kTlbPages;
+    }
+    touchSink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+void CacheController::scrambleBranches() const {
+    using Step = uint64_t (*)(uint64_t);
+    static const Step steps[] = {branchA, branchB, branchC, branchD};
+    static std::atomic<uint64_t> seed{0x243f6a8885a308d3ULL};
+
+    uint64_t x = seed.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed) | 1;
+    uint64_t acc = 0;
+    for (int i = 0; i < kBranchRounds; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        if (x & 1) acc += x >> 3;
+        if (x & 2) acc ^= x;
+        if ((x >> 8) % 3 == 0) acc -= x >> 11;
+        acc = steps[(x >> 20) & 3](acc);
+    }
+    touchSink.fetch_add(acc, std::memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#ifndef CACHE_CONTROL_H
+#define CACHE_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class CacheState {
+    Warm,         // leave caches as the previous iteration left them
+    FlushBuffers, // clflush every line of the registered buffers
+    EvictLlc,     // read through a buffer twice the size of the last-level cache
+};
+
+const char* cacheStateName(CacheState state);
+// Size of the largest cache of CPU 0 from sysfs, or 32 MiB when it cannot be read.
+std::size_t lastLevelCacheSize();
+
+// Puts caches, branch predictors and the TLB into a chosen state before each timed call.
+// prepare() only reads shared memory, so workers of a MultiThreadedBenchmark may call it concurrently.
+class CacheController {
+public:
+    void setState(CacheState state);
+    // Buffers flushed in FlushBuffers mode; they must outlive the benchmark run.
+    void registerBuffer(const void* data, std::size_t bytes);
+    void clearBuffers();
+    // Runs a burst of unpredictable conditional and indirect branches.
+    void scrambleBranchPredictor(bool enable);
+    // Touches one byte on each page of a buffer larger than the second-level TLB reach.
+    void scrambleTlb(bool enable);
+
+    bool active() const;
+    CacheState state() const;
+    std::string describe() const;
+    std::vector<std::pair<std::string, std::string>> metadata() const;
+
+    void prepare() const;
+
+private:
+    void flushBuffers() const;
+    void evict() const;
+    void touchPages() const;
+    void scrambleBranches() const;
+
+    CacheState state_ = CacheState::Warm;
+    std::vector<std::pair<const unsigned char*, std::size_t>> buffers_;
+    std::vector<unsigned char> evictionBuffer_;
+    std::vector<unsigned char> tlbBuffer_;
+    bool scrambleBranches_ = false;
+    bool scrambleTlb_ = false;
+};
+
+#endif // CACHE_CONTROL_H
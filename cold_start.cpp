@@ -0,0 +1,406 @@
+#include "cold_start.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+
+extern char** environ;
+
+namespace {
+
+constexpr const char* kTargetVariable = "PINNACIUM_COLD_START";
+constexpr int kChildSocketFd = 3; // where an Exec child finds its end of the socket
+
+struct ChildReport {
+    int64_t durationNs;
+    int64_t minorFaults;
+    int64_t majorFaults;
+    int64_t voluntarySwitches;
+    int64_t involuntarySwitches;
+};
+
+long long nowNs() {
+    return static_cast<long long>(ChronoTimer::start());
+}
+
+bool readFull(int fd, void* data, std::size_t size) {
+    char* at = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t count = ::read(fd, at, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        at += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+// MSG_NOSIGNAL: a child that died early must not take the parent down with SIGPIPE.
+bool sendFull(int fd, const void* data, std::size_t size) {
+    const char* at = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t count = ::send(fd, at, size, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        at += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+// The original command line, so an Exec child parses the same options and registers the same benchmarks.
+std::vector<std::string> ownArguments() {
+    std::ifstream in("/proc/self/cmdline", std::ios::binary);
+    std::string raw((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<std::string> arguments;
+    std::size_t begin = 0;
+    while (begin < raw.size()) {
+        std::size_t end = raw.find('\0', begin);
+        if (end == std::string::npos) end = raw.size();
+        arguments.push_back(raw.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return arguments;
+}
+
+std::vector<char*> pointers(std::vector<std::string>& values) {
+    std::vector<char*> result;
+    result.reserve(values.size() + 1);
+    for (auto& value : values) result.push_back(&value[0]);
+    result.push_back(nullptr);
+    return result;
+}
+
+bool dropPageCache() {
+    ::sync();
+    int fd = ::open("/proc/sys/vm/drop_caches", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::write(fd, "1", 1) == 1;
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+const char* coldStartLaunchName(ColdStartLaunch launch) {
+    switch (launch) {
+    case ColdStartLaunch::Fork:
+        return "fork";
+    case ColdStartLaunch::Exec:
+        return "exec";
+    }
+    return "unknown";
+}
+
+const char* coldStartChildTarget() {
+    return std::getenv(kTargetVariable);
+}
+
+ColdStartBenchmark::ColdStartBenchmark(std::string name, BenchmarkFunction fn, int iterations, ColdStartOptions options)
+    : BenchmarkCore(std::move(name), iterations, 0), function_(std::move(fn)), options_(options) {
+    timerKind_ = TimerKind::Chrono;
+}
+
+void ColdStartBenchmark::run() {
+    if (const char* target = coldStartChildTarget()) {
+        // Inside an Exec child: become the child of the benchmark it was started for and skip any other.
+        if (name_ == target) runChild(kChildSocketFd);
+        return;
+    }
+    {
+        InlineExecutor executor(executionPolicy_);
+        attachExecutor(executor);
+        waitAtStartBarrier();
+        beginMeasurement();
+        coldSamples_.clear();
+        coldSamples_.reserve(static_cast<std::size_t>(iterations_));
+        failedLaunches_ = 0;
+        finishMeasurement(runChildren());
+        detachExecutor();
+    }
+    printResults();
+    exportResults();
+}
+
+void ColdStartBenchmark::setColdStartOptions(ColdStartOptions options) {
+    options_ = options;
+}
+
+const ColdStartOptions& ColdStartBenchmark::coldStartOptions() const {
+    return options_;
+}
+
+const std::vector<ColdStartSample>& ColdStartBenchmark::coldSamples() const {
+    return coldSamples_;
+}
+
+int ColdStartBenchmark::failedLaunches() const {
+    return failedLaunches_;
+}
+
+// Children are only started and reaped between timed calls, and every pooled child has reached its
+// ready point before the oldest one is released, so at most idle, blocked processes share the machine
+// with the call being measured.
+int ColdStartBenchmark::runChildren() {
+    const std::size_t poolSize = options_.dropPageCache ? 1 : static_cast<std::size_t>(std::max(options_.poolSize, 1));
+    bool dropCache = options_.dropPageCache;
+    std::deque<Child> pool;
+    int launched = 0;
+    int completed = 0;
+    while (launched < iterations_ || !pool.empty()) {
+        while (pool.size() < poolSize && launched < iterations_) {
+            ++launched;
+            if (dropCache && !dropPageCache()) {
+                std::cerr << "Cannot drop the page cache for " << name_ << " (needs root): " << std::strerror(errno)
+                          << "; continuing with a warm cache" << std::endl;
+                dropCache = false;
+            }
+            Child child;
+            if (spawn(child, pool)) {
+                pool.push_back(child);
+            } else {
+                ++failedLaunches_;
+            }
+        }
+        for (auto it = pool.begin(); it != pool.end();) {
+            if (it->readyNs < 0 && !awaitReady(*it)) {
+                discard(*it);
+                ++failedLaunches_;
+                it = pool.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (pool.empty()) continue;
+
+        Child child = pool.front();
+        pool.pop_front();
+        ColdStartSample sample;
+        long long durationNs = 0;
+        if (!finish(child, sample, durationNs)) {
+            ++failedLaunches_;
+            continue;
+        }
+        coldSamples_.push_back(sample);
+        recordOperation(0, completed++, durationNs);
+    }
+    if (failedLaunches_ > 0) {
+        std::cerr << "Cold-start benchmark " << name_ << ": " << failedLaunches_ << " of " << iterations_
+                  << " children failed" << std::endl;
+    }
+    return completed;
+}
+
+bool ColdStartBenchmark::spawn(Child& child, const std::deque<Child>& siblings) {
+    int sockets[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        std::cerr << "socketpair for cold-start child failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    child.socket = sockets[0];
+    child.spawnNs = nowNs();
+    bool ok = options_.launch == ColdStartLaunch::Exec ? execChild(child, sockets[1]) : forkChild(child, siblings, sockets[1]);
+    ::close(sockets[1]);
+    if (!ok) {
+        ::close(child.socket);
+        child.socket = -1;
+    }
+    return ok;
+}
+
+bool ColdStartBenchmark::forkChild(Child& child, const std::deque<Child>& siblings, int childSocket) {
+    // Anything still buffered would otherwise be written twice.
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        std::cerr << "fork for cold-start child failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (pid == 0) {
+        ::close(child.socket);
+        for (const auto& sibling : siblings) ::close(sibling.socket);
+        runChild(childSocket);
+    }
+    child.pid = pid;
+    return true;
+}
+
+bool ColdStartBenchmark::execChild(Child& child, int childSocket) {
+    std::vector<std::string> arguments = ownArguments();
+    if (arguments.empty()) {
+        std::cerr << "Cannot read /proc/self/cmdline to re-execute the benchmark" << std::endl;
+        return false;
+    }
+    const std::string prefix = std::string(kTargetVariable) + "=";
+    std::vector<std::string> environment;
+    for (char** variable = environ; *variable; ++variable) {
+        if (std::strncmp(*variable, prefix.c_str(), prefix.size()) != 0) environment.emplace_back(*variable);
+    }
+    environment.push_back(prefix + name_);
+    std::vector<char*> argv = pointers(arguments);
+    std::vector<char*> envp = pointers(environment);
+
+    // The child's output would repeat everything main() prints on the way to this benchmark.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, childSocket, kChildSocketFd);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid = 0;
+    int status = ::posix_spawn(&pid, "/proc/self/exe", &actions, nullptr, argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    if (status != 0) {
+        std::cerr << "Re-executing the benchmark failed: " << std::strerror(status) << std::endl;
+        return false;
+    }
+    child.pid = pid;
+    return true;
+}
+
+bool ColdStartBenchmark::awaitReady(Child& child) {
+    int64_t readyNs = 0;
+    if (!readFull(child.socket, &readyNs, sizeof(readyNs))) {
+        std::cerr << "Cold-start child " << child.pid << " exited before becoming ready";
+        if (options_.launch == ColdStartLaunch::Exec) std::cerr << " (does main() reach " << name_ << "?)";
+        std::cerr << std::endl;
+        return false;
+    }
+    child.readyNs = readyNs;
+    return true;
+}
+
+bool ColdStartBenchmark::finish(Child& child, ColdStartSample& sample, long long& durationNs) {
+    const char go = 'g';
+    ChildReport report{};
+    bool ok = sendFull(child.socket, &go, 1) && readFull(child.socket, &report, sizeof(report));
+    ::close(child.socket);
+    child.socket = -1;
+
+    rusage usage{};
+    int status = 0;
+    while (::wait4(child.pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Cold-start child " << child.pid;
+        if (WIFSIGNALED(status)) {
+            std::cerr << " killed by signal " << WTERMSIG(status);
+        } else {
+            std::cerr << " failed with status " << (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        }
+        std::cerr << std::endl;
+        return false;
+    }
+    durationNs = report.durationNs;
+    sample.startupNs = child.readyNs - child.spawnNs;
+    sample.minorFaults = report.minorFaults;
+    sample.majorFaults = report.majorFaults;
+    sample.voluntarySwitches = report.voluntarySwitches;
+    sample.involuntarySwitches = report.involuntarySwitches;
+    sample.processMinorFaults = usage.ru_minflt;
+    sample.processMajorFaults = usage.ru_majflt;
+    return true;
+}
+
+void ColdStartBenchmark::discard(Child& child) {
+    if (child.socket >= 0) ::close(child.socket);
+    child.socket = -1;
+    if (child.pid > 0) {
+        ::kill(child.pid, SIGKILL);
+        while (::waitpid(child.pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+    child.pid = -1;
+}
+
+// Everything up to the ready message is startup; the go byte releases exactly one timed call.
+void ColdStartBenchmark::runChild(int socket) {
+    const TimerCalibration& calibration = timerCalibration(timerKind_);
+    const bool tsc = calibration.kind == TimerKind::Tsc;
+    int64_t readyNs = nowNs();
+    char go = 0;
+    if (!sendFull(socket, &readyNs, sizeof(readyNs)) || !readFull(socket, &go, 1)) ::_exit(1);
+
+    if (setupFunction_) setupFunction_();
+    rusage before{};
+    rusage after{};
+    ::getrusage(RUSAGE_SELF, &before);
+    uint64_t start = tsc ? TscTimer::start() : ChronoTimer::start();
+    function_();
+    uint64_t end = tsc ? TscTimer::stop() : ChronoTimer::stop();
+    ::getrusage(RUSAGE_SELF, &after);
+    if (teardownFunction_) teardownFunction_();
+
+    ChildReport report{};
+    report.durationNs = calibration.toNs(end - start);
+    report.minorFaults = after.ru_minflt - before.ru_minflt;
+    report.majorFaults = after.ru_majflt - before.ru_majflt;
+    report.voluntarySwitches = after.ru_nvcsw - before.ru_nvcsw;
+    report.involuntarySwitches = after.ru_nivcsw - before.ru_nivcsw;
+    ::_exit(sendFull(socket, &report, sizeof(report)) ? 0 : 1);
+}
+
+void ColdStartBenchmark::printWorkers() const {
+    std::cout << "Cold Start: " << coldStartLaunchName(options_.launch) << ", pool of "
+              << (options_.dropPageCache ? 1 : std::max(options_.poolSize, 1))
+              << (options_.dropPageCache ? ", page cache dropped" : "") << std::endl;
+    if (failedLaunches_ > 0) std::cout << "Failed Launches: " << failedLaunches_ << std::endl;
+    if (coldSamples_.empty()) return;
+    ColdStartSample mean;
+    for (const auto& sample : coldSamples_) {
+        mean.startupNs += sample.startupNs;
+        mean.minorFaults += sample.minorFaults;
+        mean.majorFaults += sample.majorFaults;
+        mean.voluntarySwitches += sample.voluntarySwitches;
+        mean.involuntarySwitches += sample.involuntarySwitches;
+        mean.processMinorFaults += sample.processMinorFaults;
+        mean.processMajorFaults += sample.processMajorFaults;
+    }
+    const double count = static_cast<double>(coldSamples_.size());
+    std::cout << "Mean Startup: " << mean.startupNs / count << " ns" << std::endl;
+    std::cout << "Mean First-Call Faults: " << mean.minorFaults / count << " minor, " << mean.majorFaults / count
+              << " major" << std::endl;
+    std::cout << "Mean First-Call Switches: " << mean.voluntarySwitches / count << " voluntary, "
+              << mean.involuntarySwitches / count << " involuntary" << std::endl;
+    std::cout << "Mean Process Faults: " << mean.processMinorFaults / count << " minor, "
+              << mean.processMajorFaults / count << " major" << std::endl;
+}
+
+void ColdStartBenchmark::addTableMetadata(ResultTable& table) const {
+    table.addMetadata("cold_start_launch", coldStartLaunchName(options_.launch));
+    table.addMetadata("cold_start_pool", std::to_string(options_.dropPageCache ? 1 : std::max(options_.poolSize, 1)));
+    table.addMetadata("cold_start_drop_page_cache", options_.dropPageCache ? "true" : "false");
+    table.addMetadata("cold_start_failures", std::to_string(failedLaunches_));
+}
+
+void ColdStartBenchmark::addWorkerColumns(ResultTable& table) const {
+    const std::size_t rows = samples_.size();
+    const std::pair<const char*, long long ColdStartSample::*> columns[] = {
+        {"Startup (ns)", &ColdStartSample::startupNs},
+        {"Minor Faults", &ColdStartSample::minorFaults},
+        {"Major Faults", &ColdStartSample::majorFaults},
+        {"Voluntary Switches", &ColdStartSample::voluntarySwitches},
+        {"Involuntary Switches", &ColdStartSample::involuntarySwitches},
+        {"Process Minor Faults", &ColdStartSample::processMinorFaults},
+        {"Process Major Faults", &ColdStartSample::processMajorFaults},
+    };
+    for (const auto& column : columns) {
+        auto& values = table.addIntColumn(column.first, rows);
+        for (const auto& sample : samples_) {
+            std::size_t index = static_cast<std::size_t>(sample.iteration);
+            values.ints.push_back(index < coldSamples_.size() ? coldSamples_[index].*column.second : 0);
+        }
+    }
+}
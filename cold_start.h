@@ -0,0 +1,94 @@
+#ifndef COLD_START_H
+#define COLD_START_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "benchmark_core.h"
+
+// Cold-path benchmarking: every iteration is the first call of the function in a fresh child process,
+// so static initialization, lazy symbol binding and first-touch page faults land in the measurement
+// instead of being hidden by warm-up.
+
+enum class ColdStartLaunch {
+    Fork, // fork() of the benchmark process; shared state is copy-on-write, lazy binding is still pending
+    Exec, // the benchmark binary re-executed from /proc/self/exe with the original arguments
+};
+
+const char* coldStartLaunchName(ColdStartLaunch launch);
+
+struct ColdStartOptions {
+    ColdStartLaunch launch = ColdStartLaunch::Fork;
+    // Children started ahead of time. Ready children block until their turn, and the pool is only
+    // refilled between iterations, so spawning never overlaps a timed call.
+    int poolSize = 4;
+    // sync() and drop the page cache (/proc/sys/vm/drop_caches, needs root) before each child starts;
+    // children are then spawned one at a time, after the drop.
+    bool dropPageCache = false;
+};
+
+// One iteration as seen by its child; fault and switch counts are getrusage(RUSAGE_SELF) differences
+// across the timed call, the process totals come from wait4().
+struct ColdStartSample {
+    long long startupNs = 0; // from spawning the child to the child being ready to call
+    long long minorFaults = 0;
+    long long majorFaults = 0;
+    long long voluntarySwitches = 0;
+    long long involuntarySwitches = 0;
+    long long processMinorFaults = 0;
+    long long processMajorFaults = 0;
+};
+
+// Set in Exec children: the name of the benchmark they were started for. runRegisteredBenchmarks()
+// then runs only that entry; a hand-written main() should reach that benchmark without side effects,
+// since everything before it runs again in every child.
+const char* coldStartChildTarget();
+
+// Runs setup, the timed call and teardown once per child. The timer defaults to the steady clock, since
+// an Exec child would otherwise recalibrate the TSC on every launch; children inherit the parent's CPU
+// affinity. Warm-up, batching, counters and convergence do not apply.
+class ColdStartBenchmark : public BenchmarkCore {
+public:
+    ColdStartBenchmark(std::string name, BenchmarkFunction fn, int iterations = 20, ColdStartOptions options = {});
+
+    ColdStartBenchmark(ColdStartBenchmark&&) = default;
+    ColdStartBenchmark& operator=(ColdStartBenchmark&&) = default;
+
+    void run() override;
+    void setColdStartOptions(ColdStartOptions options);
+
+    const ColdStartOptions& coldStartOptions() const;
+    // Parallel to samples().
+    const std::vector<ColdStartSample>& coldSamples() const;
+    int failedLaunches() const;
+
+protected:
+    void printWorkers() const override;
+    void addTableMetadata(ResultTable& table) const override;
+    void addWorkerColumns(ResultTable& table) const override;
+
+private:
+    struct Child {
+        int pid = -1;
+        int socket = -1; // parent sends the go byte, child sends its ready time and then its report
+        long long spawnNs = 0;
+        long long readyNs = -1;
+    };
+
+    bool spawn(Child& child, const std::deque<Child>& siblings);
+    bool forkChild(Child& child, const std::deque<Child>& siblings, int childSocket);
+    bool execChild(Child& child, int childSocket);
+    bool awaitReady(Child& child);
+    bool finish(Child& child, ColdStartSample& sample, long long& durationNs);
+    void discard(Child& child);
+    [[noreturn]] void runChild(int socket);
+    int runChildren();
+
+    BenchmarkFunction function_;
+    ColdStartOptions options_;
+    std::vector<ColdStartSample> coldSamples_;
+    int failedLaunches_ = 0;
+};
+
+#endif // COLD_START_H
@@ -0,0 +1,292 @@
+#include "compare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <system_error>
+
+#include "thread_pool.h"
+
+namespace {
+
+const ResultColumn* findColumn(const ResultTable& table, const std::string& name) {
+    for (const auto& column : table.columns) {
+        if (column.name == name) return &column;
+    }
+    return nullptr;
+}
+
+double valueAt(const ResultColumn& column, std::size_t row) {
+    return column.type == ResultColumn::Type::Int64 ? static_cast<double>(column.ints[row]) : column.doubles[row];
+}
+
+double median(std::vector<double>& scratch) {
+    std::size_t middle = scratch.size() / 2;
+    std::nth_element(scratch.begin(), scratch.begin() + middle, scratch.end());
+    double upper = scratch[middle];
+    if (scratch.size() % 2) return upper;
+    double lower = *std::max_element(scratch.begin(), scratch.begin() + middle);
+    return (lower + upper) / 2.0;
+}
+
+double relativeDelta(double baseline, double current) {
+    return baseline != 0.0 ? current / baseline - 1.0 : 0.0;
+}
+
+bool hasExtension(const std::filesystem::path& path) {
+    return path.extension() == ".csv" || path.extension() == ".pinb";
+}
+
+// Timer overheads and the capture date differ on every run, so only machine_ and build_ keys count.
+void addContextChanges(const ResultTable& baseline, const ResultTable& current, std::vector<std::string>& changes) {
+    std::map<std::string, std::string> after(current.metadata.begin(), current.metadata.end());
+    for (const auto& [key, before] : baseline.metadata) {
+        if (key.compare(0, 8, "machine_") != 0 && key.compare(0, 6, "build_") != 0) continue;
+        auto match = after.find(key);
+        if (match == after.end() || match->second == before) continue;
+        std::string change = key + ": " + before + " -> " + match->second;
+        if (std::find(changes.begin(), changes.end(), change) == changes.end()) changes.push_back(std::move(change));
+    }
+}
+
+} // namespace
+
+const char* significanceTestName(SignificanceTest test) {
+    switch (test) {
+    case SignificanceTest::MannWhitney:
+        return "Mann-Whitney U";
+    case SignificanceTest::Bootstrap:
+        return "bootstrap";
+    }
+    return "unknown";
+}
+
+std::size_t ComparisonReport::regressions() const {
+    return static_cast<std::size_t>(
+        std::count_if(comparisons.begin(), comparisons.end(), [](const Comparison& c) { return c.regression; }));
+}
+
+bool sampleValues(const ResultTable& table, std::vector<double>& values, std::string& column, std::size_t maxSamples) {
+    values.clear();
+    for (const char* name : {"Per-Op (ns)", "Duration (ns)"}) {
+        const ResultColumn* samples = findColumn(table, name);
+        if (!samples) continue;
+        column = name;
+        values.reserve(samples->size());
+        for (std::size_t r = 0; r < samples->size(); ++r) values.push_back(valueAt(*samples, r));
+        return !values.empty();
+    }
+
+    const ResultColumn* low = findColumn(table, "Bucket Low (ns)");
+    const ResultColumn* high = findColumn(table, "Bucket High (ns)");
+    const ResultColumn* counts = findColumn(table, "Count");
+    if (!counts) counts = findColumn(table, "Latency Count");
+    if (!low || !high || !counts) return false;
+    column = "Bucket Low (ns)";
+
+    std::size_t buckets = std::min({low->size(), high->size(), counts->size()});
+    double total = 0.0;
+    for (std::size_t b = 0; b < buckets; ++b) total += std::max(valueAt(*counts, b), 0.0);
+    if (total <= 0.0) return false;
+    // Emits each bucket's share of maxSamples, so thinning keeps the distribution's shape.
+    double scale = std::min(1.0, static_cast<double>(maxSamples) / total);
+    double cumulative = 0.0;
+    for (std::size_t b = 0; b < buckets; ++b) {
+        double before = std::floor(cumulative * scale);
+        cumulative += std::max(valueAt(*counts, b), 0.0);
+        double copies = std::floor(cumulative * scale) - before;
+        double midpoint = (valueAt(*low, b) + valueAt(*high, b)) / 2.0;
+        values.insert(values.end(), static_cast<std::size_t>(copies), midpoint);
+    }
+    return !values.empty();
+}
+
+double mannWhitneyPValue(const std::vector<double>& baseline, const std::vector<double>& current) {
+    std::size_t n1 = baseline.size();
+    std::size_t n2 = current.size();
+    if (n1 == 0 || n2 == 0) return 1.0;
+
+    std::vector<std::pair<double, bool>> pooled;
+    pooled.reserve(n1 + n2);
+    for (double value : baseline) pooled.emplace_back(value, false);
+    for (double value : current) pooled.emplace_back(value, true);
+    std::sort(pooled.begin(), pooled.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // Tied values share the average of their ranks; sum(t^3 - t) corrects the variance for them.
+    double rankSum = 0.0;
+    double tieTerm = 0.0;
+    for (std::size_t i = 0; i < pooled.size();) {
+        std::size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) ++j;
+        double rank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2.0;
+        for (std::size_t k = i; k < j; ++k) {
+            if (!pooled[k].second) rankSum += rank;
+        }
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    double a = static_cast<double>(n1);
+    double b = static_cast<double>(n2);
+    double n = a + b;
+    double u = rankSum - a * (a + 1.0) / 2.0;
+    double mean = a * b / 2.0;
+    double variance = a * b / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+    if (variance <= 0.0) return 1.0;
+    double z = std::max(std::fabs(u - mean) - 0.5, 0.0) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+BootstrapDelta bootstrapRelativeDelta(const std::vector<double>& baseline, const std::vector<double>& current,
+                                      double confidence, int resamples, uint64_t seed, Executor* executor) {
+    BootstrapDelta result;
+    if (baseline.empty() || current.empty()) return result;
+
+    std::vector<double> scratchBaseline(baseline);
+    std::vector<double> scratchCurrent(current);
+    result.interval.estimate = relativeDelta(median(scratchBaseline), median(scratchCurrent));
+    if (resamples < 2 || (baseline.size() < 2 && current.size() < 2)) {
+        result.interval.lower = result.interval.upper = result.interval.estimate;
+        return result;
+    }
+
+    // Resample r draws both sides from stream r, so the split across workers does not change the result.
+    std::vector<double> deltas(static_cast<std::size_t>(resamples));
+    const int workers = executor ? std::max(executor->size(), 1) : 1;
+    auto task = [&](int worker) {
+        std::vector<double> before(baseline.size());
+        std::vector<double> after(current.size());
+        for (int r = worker; r < resamples; r += workers) {
+            ResampleStream stream(seed, static_cast<uint64_t>(r));
+            resample(baseline.data(), baseline.size(), stream, before.data(), before.size());
+            resample(current.data(), current.size(), stream, after.data(), after.size());
+            deltas[r] = relativeDelta(median(before), median(after));
+        }
+    };
+    if (executor) {
+        executor->run(task, workers);
+    } else {
+        task(0);
+    }
+
+    std::size_t atOrBelowZero = 0;
+    std::size_t atOrAboveZero = 0;
+    for (double delta : deltas) {
+        if (delta <= 0.0) ++atOrBelowZero;
+        if (delta >= 0.0) ++atOrAboveZero;
+    }
+    std::sort(deltas.begin(), deltas.end());
+
+    double alpha = (1.0 - confidence) / 2.0;
+    auto at = [&deltas](double q) {
+        std::size_t index = static_cast<std::size_t>(q * static_cast<double>(deltas.size() - 1) + 0.5);
+        return deltas[std::min(index, deltas.size() - 1)];
+    };
+    result.interval.lower = at(alpha);
+    result.interval.upper = at(1.0 - alpha);
+    double tail = static_cast<double>(std::min(atOrBelowZero, atOrAboveZero)) / static_cast<double>(deltas.size());
+    result.pValue = std::min(1.0, 2.0 * tail);
+    return result;
+}
+
+Comparison compareSamples(const std::string& name, const std::vector<double>& baseline,
+                          const std::vector<double>& current, const CompareOptions& options) {
+    Comparison comparison;
+    comparison.name = name;
+    comparison.baselineCount = baseline.size();
+    comparison.currentCount = current.size();
+    if (baseline.empty() || current.empty()) return comparison;
+
+    std::vector<double> scratch(baseline);
+    comparison.baselineMedian = median(scratch);
+    scratch = current;
+    comparison.currentMedian = median(scratch);
+
+    BootstrapDelta bootstrap =
+        bootstrapRelativeDelta(baseline, current, 1.0 - options.alpha, options.resamples, options.seed, options.executor);
+    comparison.delta = bootstrap.interval;
+    comparison.pValue =
+        options.test == SignificanceTest::Bootstrap ? bootstrap.pValue : mannWhitneyPValue(baseline, current);
+    comparison.significant = comparison.pValue < options.alpha;
+    comparison.regression = comparison.significant && comparison.delta.estimate > options.threshold;
+    comparison.improvement = comparison.significant && comparison.delta.estimate < -options.threshold;
+    return comparison;
+}
+
+ComparisonReport compareResults(const std::vector<ResultTable>& baseline, const std::vector<ResultTable>& current,
+                                const CompareOptions& options) {
+    ComparisonReport report;
+    std::map<std::string, const ResultTable*> currentByName;
+    for (const auto& table : current) currentByName.emplace(table.name, &table);
+
+    std::map<std::string, bool> seen;
+    for (const auto& table : baseline) {
+        if (!seen.emplace(table.name, true).second) continue;
+        auto match = currentByName.find(table.name);
+        if (match == currentByName.end()) {
+            report.missing.push_back(table.name);
+            continue;
+        }
+        std::vector<double> before, after;
+        std::string column, currentColumn;
+        if (!sampleValues(table, before, column) || !sampleValues(*match->second, after, currentColumn)) {
+            report.skipped.push_back(table.name);
+            continue;
+        }
+        addContextChanges(table, *match->second, report.contextChanges);
+        Comparison comparison = compareSamples(table.name, before, after, options);
+        comparison.column = column == currentColumn ? column : column + " / " + currentColumn;
+        report.comparisons.push_back(std::move(comparison));
+    }
+    for (const auto& [name, table] : currentByName) {
+        if (!seen.count(name)) report.added.push_back(name);
+    }
+    return report;
+}
+
+bool loadResults(const std::string& path, std::vector<ResultTable>& tables, std::string& error) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+        ResultTable table;
+        if (!readResults(path, table, error)) return false;
+        tables.push_back(std::move(table));
+        return true;
+    }
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+        if (entry.is_regular_file(ec) && hasExtension(entry.path())) files.push_back(entry.path());
+    }
+    if (ec) {
+        error = path + ": " + ec.message();
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& file : files) {
+        ResultTable table;
+        if (!readResults(file.string(), table, error)) return false;
+        tables.push_back(std::move(table));
+    }
+    return true;
+}
+
+void printComparison(const ComparisonReport& report, const CompareOptions& options) {
+    std::cout << "Comparison (" << significanceTestName(options.test) << ", alpha " << options.alpha
+              << ", threshold " << options.threshold * 100.0 << "%)" << std::endl;
+    std::cout << "Benchmark,Baseline Median (ns),Current Median (ns),Delta (%),CI Low (%),CI High (%),p,Verdict"
+              << std::endl;
+    for (const auto& c : report.comparisons) {
+        const char* verdict = c.regression ? "REGRESSION" : c.improvement ? "improved" : c.significant ? "changed" : "same";
+        std::cout << c.name << "," << c.baselineMedian << "," << c.currentMedian << "," << c.delta.estimate * 100.0
+                  << "," << c.delta.lower * 100.0 << "," << c.delta.upper * 100.0 << "," << c.pValue << ","
+                  << verdict << std::endl;
+    }
+    for (const auto& name : report.missing) std::cout << "Missing from current run: " << name << std::endl;
+    for (const auto& name : report.added) std::cout << "New in current run: " << name << std::endl;
+    for (const auto& name : report.skipped) std::cout << "Skipped (no per-call times): " << name << std::endl;
+    for (const auto& change : report.contextChanges) std::cout << "Context changed: " << change << std::endl;
+    std::cout << "Regressions: " << report.regressions() << " of " << report.comparisons.size() << std::endl;
+}
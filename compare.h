@@ -0,0 +1,87 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "result_sink.h"
+#include "stats.h"
+
+enum class SignificanceTest {
+    MannWhitney, // two-sided Mann-Whitney U, normal approximation with tie correction
+    Bootstrap,   // two-sided percentile bootstrap of the ratio of medians
+};
+
+const char* significanceTestName(SignificanceTest test);
+
+struct CompareOptions {
+    double threshold = 0.05; // relative slowdown of the median that counts as a regression
+    double alpha = 0.05;     // significance level; the delta CI uses confidence 1 - alpha
+    SignificanceTest test = SignificanceTest::MannWhitney;
+    int resamples = 2000;
+    uint64_t seed = 0x5eed;
+    Executor* executor = nullptr; // splits bootstrap resamples across its workers when set
+};
+
+// Relative change of the median, current / baseline - 1; positive means slower.
+struct Comparison {
+    std::string name;
+    std::string column;
+    std::size_t baselineCount = 0;
+    std::size_t currentCount = 0;
+    double baselineMedian = 0.0;
+    double currentMedian = 0.0;
+    ConfidenceInterval delta;
+    double pValue = 1.0;
+    bool significant = false;
+    bool regression = false;  // significant and delta.estimate > threshold
+    bool improvement = false; // significant and delta.estimate < -threshold
+};
+
+struct ComparisonReport {
+    std::vector<Comparison> comparisons;
+    std::vector<std::string> missing; // in the baseline but not in the current run
+    std::vector<std::string> added;   // in the current run but not in the baseline
+    std::vector<std::string> skipped; // matched, but without a column of per-call times
+    // "key: baseline -> current" for each machine_ or build_ context entry that differs between matched
+    // tables (see machine_info.h); non-empty means the runs are not like for like.
+    std::vector<std::string> contextChanges;
+
+    std::size_t regressions() const;
+};
+
+// Per-call times of a table: "Per-Op (ns)" when batched, else "Duration (ns)", else a latency histogram
+// ("Bucket Low/High (ns)" with "Count" or "Latency Count") expanded at bucket midpoints and thinned to
+// at most maxSamples values. Returns false for tables without one (scaling, throughput).
+bool sampleValues(const ResultTable& table, std::vector<double>& values, std::string& column,
+                  std::size_t maxSamples = 200000);
+
+// Two-sided p-value of the Mann-Whitney U test.
+double mannWhitneyPValue(const std::vector<double>& baseline, const std::vector<double>& current);
+
+struct BootstrapDelta {
+    ConfidenceInterval interval; // of median(current) / median(baseline) - 1
+    double pValue = 1.0;         // twice the smaller tail of resampled deltas beyond zero
+};
+
+// Deterministic for a given seed whatever the executor, whose workers must be idle.
+BootstrapDelta bootstrapRelativeDelta(const std::vector<double>& baseline, const std::vector<double>& current,
+                                      double confidence = 0.95, int resamples = 2000, uint64_t seed = 0x5eed,
+                                      Executor* executor = nullptr);
+
+Comparison compareSamples(const std::string& name, const std::vector<double>& baseline,
+                          const std::vector<double>& current, const CompareOptions& options = CompareOptions());
+
+// Matches tables by name, which carries the benchmark's parameters ("Sort/1024").
+ComparisonReport compareResults(const std::vector<ResultTable>& baseline, const std::vector<ResultTable>& current,
+                                 const CompareOptions& options = CompareOptions());
+
+// Loads one result file, or every ".csv" and ".pinb" file of a directory in name order.
+// Returns false and sets error when a file cannot be read.
+bool loadResults(const std::string& path, std::vector<ResultTable>& tables, std::string& error);
+
+void printComparison(const ComparisonReport& report, const CompareOptions& options = CompareOptions());
+
+#endif // COMPARE_H
@@ -0,0 +1,83 @@
+#include "complexity.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* complexityName(Complexity complexity) {
+    switch (complexity) {
+    case Complexity::O1:
+        return "O(1)";
+    case Complexity::OLogN:
+        return "O(log n)";
+    case Complexity::ON:
+        return "O(n)";
+    case Complexity::ONLogN:
+        return "O(n log n)";
+    case Complexity::ON2:
+        return "O(n^2)";
+    }
+    return "O(?)";
+}
+
+double complexityTerm(Complexity complexity, double n) {
+    switch (complexity) {
+    case Complexity::O1:
+        return 1.0;
+    case Complexity::OLogN:
+        return std::log2(std::max(n, 2.0));
+    case Complexity::ON:
+        return n;
+    case Complexity::ONLogN:
+        return n * std::log2(std::max(n, 2.0));
+    case Complexity::ON2:
+        return n * n;
+    }
+    return 1.0;
+}
+
+const std::vector<Complexity>& allComplexities() {
+    static const std::vector<Complexity> complexities = {
+        Complexity::O1, Complexity::OLogN, Complexity::ON, Complexity::ONLogN, Complexity::ON2,
+    };
+    return complexities;
+}
+
+ComplexityFit fitComplexity(const std::vector<int64_t>& n, const std::vector<double>& time, Complexity complexity) {
+    ComplexityFit fit;
+    fit.complexity = complexity;
+    if (n.empty() || n.size() != time.size()) return fit;
+
+    double termTime = 0.0;
+    double termTerm = 0.0;
+    double meanTime = 0.0;
+    for (std::size_t i = 0; i < n.size(); ++i) {
+        double term = complexityTerm(complexity, static_cast<double>(n[i]));
+        termTime += term * time[i];
+        termTerm += term * term;
+        meanTime += time[i];
+    }
+    meanTime /= static_cast<double>(n.size());
+    fit.coefficient = termTerm > 0.0 ? termTime / termTerm : 0.0;
+
+    double residual = 0.0;
+    for (std::size_t i = 0; i < n.size(); ++i) {
+        double error = time[i] - fit.coefficient * complexityTerm(complexity, static_cast<double>(n[i]));
+        residual += error * error;
+    }
+    double rms = std::sqrt(residual / static_cast<double>(n.size()));
+    fit.rms = meanTime > 0.0 ? rms / meanTime : rms;
+    return fit;
+}
+
+ComplexityFit bestComplexityFit(const std::vector<int64_t>& n, const std::vector<double>& time) {
+    ComplexityFit best;
+    bool first = true;
+    for (Complexity complexity : allComplexities()) {
+        ComplexityFit fit = fitComplexity(n, time, complexity);
+        if (first || fit.rms < best.rms) {
+            best = fit;
+            first = false;
+        }
+    }
+    return best;
+}
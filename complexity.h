@@ -0,0 +1,30 @@
+#ifndef COMPLEXITY_H
+#define COMPLEXITY_H
+
+#include <cstdint>
+#include <vector>
+
+enum class Complexity {
+    O1,
+    OLogN,
+    ON,
+    ONLogN,
+    ON2,
+};
+
+struct ComplexityFit {
+    Complexity complexity = Complexity::O1;
+    double coefficient = 0.0; // time ~= coefficient * f(n)
+    double rms = 0.0;         // root-mean-square residual relative to the mean time
+};
+
+const char* complexityName(Complexity complexity);
+double complexityTerm(Complexity complexity, double n);
+const std::vector<Complexity>& allComplexities();
+
+// Least-squares fit of time = c * f(n) through the origin.
+ComplexityFit fitComplexity(const std::vector<int64_t>& n, const std::vector<double>& time, Complexity complexity);
+// Fits every model and returns the one with the lowest relative RMS.
+ComplexityFit bestComplexityFit(const std::vector<int64_t>& n, const std::vector<double>& time);
+
+#endif // COMPLEXITY_H
@@ -0,0 +1,669 @@
+#include "distributed.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+extern char** environ;
+
+namespace {
+
+// Every message is a little-endian u32 type and u32 payload length followed by the payload.
+enum class MessageType : uint32_t {
+    Hello = 1, // worker -> coordinator: benchmark name
+    Ready,     // worker -> coordinator: waiting at the start barrier
+    Ping,      // coordinator -> worker: coordinator send time
+    Pong,      // worker -> coordinator: echoed send time, worker receive and send times
+    Start,     // coordinator -> worker: start instant on the worker's clock
+    Result,    // worker -> coordinator: operations, seconds and the latency histogram
+};
+
+constexpr uint32_t kMaxPayload = 64u << 20;
+// Ready and Result follow a whole warm-up or measurement phase, which may take any length of time, so
+// they are awaited without a deadline; TCP keepalive still turns a vanished host into a socket error.
+constexpr std::chrono::milliseconds kWholePhase{-1};
+
+struct Message {
+    MessageType type = MessageType::Hello;
+    std::vector<uint8_t> payload;
+};
+
+class PayloadWriter {
+public:
+    void put(uint64_t value) {
+        for (int i = 0; i < 8; ++i) bytes_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void putSigned(int64_t value) {
+        put(static_cast<uint64_t>(value));
+    }
+
+    void putDouble(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        put(bits);
+    }
+
+    void putString(const std::string& value) {
+        put(value.size());
+        bytes_.insert(bytes_.end(), value.begin(), value.end());
+    }
+
+    const std::vector<uint8_t>& bytes() const {
+        return bytes_;
+    }
+
+private:
+    std::vector<uint8_t> bytes_;
+};
+
+class PayloadReader {
+public:
+    explicit PayloadReader(const std::vector<uint8_t>& bytes) : bytes_(bytes) {}
+
+    bool get(uint64_t& value) {
+        if (bytes_.size() - offset_ < 8) return false;
+        value = 0;
+        for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(bytes_[offset_ + i]) << (8 * i);
+        offset_ += 8;
+        return true;
+    }
+
+    bool getSigned(int64_t& value) {
+        uint64_t bits;
+        if (!get(bits)) return false;
+        value = static_cast<int64_t>(bits);
+        return true;
+    }
+
+    bool getDouble(double& value) {
+        uint64_t bits;
+        if (!get(bits)) return false;
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        uint64_t size;
+        if (!get(size) || bytes_.size() - offset_ < size) return false;
+        value.assign(bytes_.begin() + offset_, bytes_.begin() + offset_ + size);
+        offset_ += size;
+        return true;
+    }
+
+private:
+    const std::vector<uint8_t>& bytes_;
+    std::size_t offset_ = 0;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t getU32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    return value;
+}
+
+bool writeAll(int fd, const uint8_t* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// A negative timeout waits until data arrives or the peer goes away.
+bool readAll(int fd, uint8_t* data, std::size_t size, std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (size > 0) {
+        int wait = -1;
+        if (timeout.count() >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() < 0) return false;
+            wait = static_cast<int>(std::min<long long>(left.count(), std::numeric_limits<int>::max()));
+        }
+        pollfd descriptor{fd, POLLIN, 0};
+        int ready = ::poll(&descriptor, 1, wait);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return false;
+        ssize_t received = ::recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        data += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+bool sendMessage(int fd, MessageType type, const PayloadWriter& payload = {}) {
+    const auto& bytes = payload.bytes();
+    uint8_t header[8];
+    putU32(header, static_cast<uint32_t>(type));
+    putU32(header + 4, static_cast<uint32_t>(bytes.size()));
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, bytes.data(), bytes.size());
+}
+
+bool receiveMessage(int fd, Message& message, std::chrono::milliseconds timeout) {
+    uint8_t header[8];
+    if (!readAll(fd, header, sizeof(header), timeout)) return false;
+    uint32_t size = getU32(header + 4);
+    if (size > kMaxPayload) return false;
+    message.type = static_cast<MessageType>(getU32(header));
+    message.payload.resize(size);
+    return readAll(fd, message.payload.data(), size, timeout);
+}
+
+// No Nagle delay for the ping rounds, and keepalive probes so a peer that disappears mid-phase (power
+// loss, network partition) is noticed after about a minute and a half of silence.
+void configureSocket(int fd) {
+    int enable = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+#ifdef TCP_KEEPIDLE
+    int idle = 30, interval = 10, probes = 6;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+#endif
+}
+
+std::string peerAddress(const sockaddr_storage& address) {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (address.ss_family == AF_INET) {
+        const auto& in = reinterpret_cast<const sockaddr_in&>(address);
+        ::inet_ntop(AF_INET, &in.sin_addr, text, sizeof(text));
+        return std::string(text) + ":" + std::to_string(ntohs(in.sin_port));
+    }
+    if (address.ss_family == AF_INET6) {
+        const auto& in6 = reinterpret_cast<const sockaddr_in6&>(address);
+        ::inet_ntop(AF_INET6, &in6.sin6_addr, text, sizeof(text));
+        return "[" + std::string(text) + "]:" + std::to_string(ntohs(in6.sin6_port));
+    }
+    return "unknown";
+}
+
+// Waits without burning the CPU until shortly before the deadline, then spins on the clock.
+void spinUntil(int64_t deadlineNs) {
+    constexpr int64_t kSpinNs = 2000000;
+    int64_t left = deadlineNs - nowNs();
+    if (left > kSpinNs) std::this_thread::sleep_for(std::chrono::nanoseconds(left - kSpinNs));
+    while (nowNs() < deadlineNs) cpuRelax();
+}
+
+// A histogram of batch times as the per-call distribution the coordinator merges across workers: each
+// batch counts as batch calls of duration / batch, the same normalization the live telemetry applies.
+Histogram perOperation(const Histogram& batches, uint64_t batch) {
+    Histogram calls(batches.precisionBits());
+    for (std::size_t i = 0; i < batches.bucketCount(); ++i) {
+        if (!batches.countAt(i)) continue;
+        uint64_t middle = batches.bucketLow(i) + (batches.bucketHigh(i) - batches.bucketLow(i)) / 2;
+        calls.record(middle / batch, batches.countAt(i) * batch);
+    }
+    std::vector<std::pair<std::size_t, uint64_t>> buckets;
+    for (std::size_t i = 0; i < calls.bucketCount(); ++i) {
+        if (calls.countAt(i)) buckets.emplace_back(i, calls.countAt(i));
+    }
+    calls.restore(buckets, batches.min() / batch, batches.max() / batch, batches.sum());
+    return calls;
+}
+
+bool decodeResult(const Message& message, WorkerReport& report) {
+    PayloadReader reader(message.payload);
+    int64_t operations;
+    uint64_t precisionBits, min, max, buckets;
+    double sum;
+    if (!reader.getString(report.name) || !reader.getSigned(operations) || !reader.getDouble(report.seconds) ||
+        !reader.get(precisionBits) || !reader.get(min) || !reader.get(max) || !reader.getDouble(sum) ||
+        !reader.get(buckets) || precisionBits < 1 || precisionBits > 16) {
+        return false;
+    }
+    std::vector<std::pair<std::size_t, uint64_t>> counts;
+    for (uint64_t b = 0; b < buckets; ++b) {
+        uint64_t index, count;
+        if (!reader.get(index) || !reader.get(count)) return false;
+        counts.emplace_back(static_cast<std::size_t>(index), count);
+    }
+    report.operations = operations;
+    report.latency = Histogram(static_cast<int>(precisionBits));
+    report.latency.restore(counts, min, max, sum);
+    return true;
+}
+
+} // namespace
+
+double WorkerReport::opsPerSecond() const {
+    return seconds > 0.0 ? static_cast<double>(operations) / seconds : 0.0;
+}
+
+long long DistributedResult::operations() const {
+    long long total = 0;
+    for (const auto& worker : workers) total += worker.operations;
+    return total;
+}
+
+double DistributedResult::seconds() const {
+    double longest = 0.0;
+    for (const auto& worker : workers) longest = std::max(longest, worker.seconds);
+    return longest;
+}
+
+double DistributedResult::opsPerSecond() const {
+    double total = 0.0;
+    for (const auto& worker : workers) total += worker.opsPerSecond();
+    return total;
+}
+
+DistributedCoordinator::DistributedCoordinator(DistributedOptions options) : options_(std::move(options)) {}
+
+DistributedCoordinator::~DistributedCoordinator() {
+    closeAll();
+    waitForLaunched();
+}
+
+void DistributedCoordinator::addWorkerCommand(std::string command) {
+    commands_.push_back(std::move(command));
+}
+
+bool DistributedCoordinator::run() {
+    result_ = DistributedResult();
+    error_.clear();
+    const int count = options_.workers > 0 ? options_.workers : static_cast<int>(commands_.size());
+    bool ok = count > 0 ? listen() && launch() && acceptWorkers(count) && collectResults()
+                        : fail("no workers to wait for");
+    closeAll();
+    waitForLaunched();
+    return ok && error_.empty();
+}
+
+bool DistributedCoordinator::listen() {
+    listenSocket_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenSocket_ < 0) return fail(std::string("socket: ") + std::strerror(errno));
+    int enable = 1;
+    ::setsockopt(listenSocket_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(options_.port);
+    if (::bind(listenSocket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenSocket_, SOMAXCONN) != 0) {
+        return fail("listen on port " + std::to_string(options_.port) + ": " + std::strerror(errno));
+    }
+    std::cout << "Coordinator listening on port " << options_.port << std::endl;
+    return true;
+}
+
+bool DistributedCoordinator::launch() {
+    for (const auto& command : commands_) {
+        const char* argv[] = {"/bin/sh", "-c", command.c_str(), nullptr};
+        pid_t pid = 0;
+        int status = ::posix_spawn(&pid, "/bin/sh", nullptr, nullptr, const_cast<char* const*>(argv), environ);
+        if (status != 0) return fail("launch '" + command + "': " + std::strerror(status));
+        launched_.push_back(pid);
+    }
+    return true;
+}
+
+bool DistributedCoordinator::acceptWorkers(int count) {
+    while (static_cast<int>(sockets_.size()) < count) {
+        pollfd descriptor{listenSocket_, POLLIN, 0};
+        int ready = ::poll(&descriptor, 1, static_cast<int>(options_.timeout.count()));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            return fail("timed out with " + std::to_string(sockets_.size()) + " of " + std::to_string(count) +
+                        " workers connected");
+        }
+        sockaddr_storage address{};
+        socklen_t length = sizeof(address);
+        int fd = ::accept4(listenSocket_, reinterpret_cast<sockaddr*>(&address), &length, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return fail(std::string("accept: ") + std::strerror(errno));
+        }
+        configureSocket(fd);
+        sockets_.push_back(fd);
+
+        WorkerReport worker;
+        worker.address = peerAddress(address);
+        Message hello;
+        if (!receiveMessage(fd, hello, options_.timeout) || hello.type != MessageType::Hello ||
+            !PayloadReader(hello.payload).getString(worker.name)) {
+            return fail("no hello from " + worker.address);
+        }
+        std::cout << "Worker " << sockets_.size() << "/" << count << " connected: " << worker.name << " from "
+                  << worker.address << std::endl;
+        result_.workers.push_back(std::move(worker));
+    }
+    return true;
+}
+
+// Workers move through the same phases, so messages are read in lockstep: all Ready means another
+// start barrier, all Result means the run is over.
+bool DistributedCoordinator::collectResults() {
+    std::vector<Message> messages(sockets_.size());
+    while (true) {
+        for (std::size_t w = 0; w < sockets_.size(); ++w) {
+            if (!receiveMessage(sockets_[w], messages[w], kWholePhase)) {
+                return fail("lost worker " + result_.workers[w].address);
+            }
+        }
+        MessageType type = messages.front().type;
+        for (const auto& message : messages) {
+            if (message.type != type) return fail("workers are out of step");
+        }
+        if (type == MessageType::Ready) {
+            if (!synchronizeStart()) return false;
+            continue;
+        }
+        if (type != MessageType::Result) return fail("unexpected message from worker");
+        break;
+    }
+
+    for (std::size_t w = 0; w < messages.size(); ++w) {
+        WorkerReport& worker = result_.workers[w];
+        if (!decodeResult(messages[w], worker)) return fail("malformed result from " + worker.address);
+        if (w == 0) result_.latency = Histogram(worker.latency.precisionBits());
+        result_.latency.merge(worker.latency);
+    }
+    return true;
+}
+
+// For each ping round: offset = ((t1 - t0) + (t2 - t3)) / 2 and round trip = (t3 - t0) - (t2 - t1),
+// where t0 and t3 are on the coordinator's clock and t1 and t2 on the worker's. The round with the
+// smallest round trip has the least queueing asymmetry, so its offset is kept.
+bool DistributedCoordinator::synchronizeStart() {
+    long long slowest = 0;
+    for (std::size_t w = 0; w < sockets_.size(); ++w) {
+        WorkerReport& worker = result_.workers[w];
+        long long bestRoundTrip = std::numeric_limits<long long>::max();
+        for (int round = 0; round < std::max(1, options_.syncRounds); ++round) {
+            PayloadWriter ping;
+            ping.putSigned(nowNs());
+            Message pong;
+            if (!sendMessage(sockets_[w], MessageType::Ping, ping) ||
+                !receiveMessage(sockets_[w], pong, options_.timeout)) {
+                return fail("lost worker " + worker.address + " during clock sync");
+            }
+            int64_t t3 = nowNs();
+            int64_t t0, t1, t2;
+            PayloadReader reader(pong.payload);
+            if (pong.type != MessageType::Pong || !reader.getSigned(t0) || !reader.getSigned(t1) || !reader.getSigned(t2)) {
+                return fail("malformed pong from " + worker.address);
+            }
+            long long roundTrip = (t3 - t0) - (t2 - t1);
+            if (roundTrip < bestRoundTrip) {
+                bestRoundTrip = roundTrip;
+                worker.roundTripNs = roundTrip;
+                worker.clockOffsetNs = ((t1 - t0) + (t2 - t3)) / 2;
+            }
+        }
+        slowest = std::max(slowest, worker.roundTripNs);
+    }
+
+    const int64_t start = nowNs() + options_.startMargin.count() + slowest;
+    for (std::size_t w = 0; w < sockets_.size(); ++w) {
+        PayloadWriter message;
+        message.putSigned(start + result_.workers[w].clockOffsetNs);
+        if (!sendMessage(sockets_[w], MessageType::Start, message)) {
+            return fail("lost worker " + result_.workers[w].address + " at start");
+        }
+    }
+    return true;
+}
+
+void DistributedCoordinator::waitForLaunched() {
+    for (pid_t pid : launched_) {
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Worker process " << pid << " exited abnormally (status " << status << ")" << std::endl;
+        }
+    }
+    launched_.clear();
+}
+
+void DistributedCoordinator::closeAll() {
+    for (int fd : sockets_) ::close(fd);
+    sockets_.clear();
+    if (listenSocket_ >= 0) ::close(listenSocket_);
+    listenSocket_ = -1;
+}
+
+bool DistributedCoordinator::fail(std::string message) {
+    if (error_.empty()) error_ = std::move(message);
+    return false;
+}
+
+const DistributedResult& DistributedCoordinator::result() const {
+    return result_;
+}
+
+const std::string& DistributedCoordinator::error() const {
+    return error_;
+}
+
+ResultTable DistributedCoordinator::workerTable() const {
+    ResultTable table;
+    const std::string name = result_.workers.empty() ? "distributed" : result_.workers.front().name + "/distributed";
+    table.name = name + "/workers";
+    table.addMetadata("workers", std::to_string(result_.workers.size()));
+    const std::size_t rows = result_.workers.size();
+    ResultColumn& index = table.addIntColumn("Worker", rows);
+    for (std::size_t w = 0; w < rows; ++w) index.ints.push_back(static_cast<int64_t>(w));
+    ResultColumn& offset = table.addIntColumn("Clock Offset (ns)", rows);
+    for (const auto& worker : result_.workers) offset.ints.push_back(worker.clockOffsetNs);
+    ResultColumn& roundTrip = table.addIntColumn("Round Trip (ns)", rows);
+    for (const auto& worker : result_.workers) roundTrip.ints.push_back(worker.roundTripNs);
+    ResultColumn& operations = table.addIntColumn("Operations", rows);
+    for (const auto& worker : result_.workers) operations.ints.push_back(worker.operations);
+    ResultColumn& seconds = table.addDoubleColumn("Seconds", rows);
+    for (const auto& worker : result_.workers) seconds.doubles.push_back(worker.seconds);
+    ResultColumn& rate = table.addDoubleColumn("Ops/s", rows);
+    for (const auto& worker : result_.workers) rate.doubles.push_back(worker.opsPerSecond());
+    return table;
+}
+
+ResultTable DistributedCoordinator::latencyTable() const {
+    ResultTable table;
+    table.name = result_.workers.empty() ? "distributed" : result_.workers.front().name + "/distributed";
+    table.addMetadata("workers", std::to_string(result_.workers.size()));
+    table.addMetadata("operations", std::to_string(result_.operations()));
+    table.addMetadata("ops_per_second", std::to_string(result_.opsPerSecond()));
+
+    const Histogram& histogram = result_.latency;
+    std::vector<std::size_t> buckets;
+    for (std::size_t i = 0; i < histogram.bucketCount(); ++i) {
+        if (histogram.countAt(i)) buckets.push_back(i);
+    }
+    ResultColumn& low = table.addIntColumn("Bucket Low (ns)", buckets.size());
+    for (std::size_t i : buckets) low.ints.push_back(static_cast<int64_t>(histogram.bucketLow(i)));
+    ResultColumn& high = table.addIntColumn("Bucket High (ns)", buckets.size());
+    for (std::size_t i : buckets) high.ints.push_back(static_cast<int64_t>(histogram.bucketHigh(i)));
+    ResultColumn& count = table.addIntColumn("Count", buckets.size());
+    for (std::size_t i : buckets) count.ints.push_back(static_cast<int64_t>(histogram.countAt(i)));
+    return table;
+}
+
+void DistributedCoordinator::printResults() const {
+    std::cout << "Distributed Results (" << result_.workers.size() << " workers)" << std::endl;
+    std::cout << "Worker,Name,Address,Clock Offset (ns),Round Trip (ns),Operations,Seconds,Ops/s" << std::endl;
+    for (std::size_t w = 0; w < result_.workers.size(); ++w) {
+        const WorkerReport& worker = result_.workers[w];
+        std::cout << w << "," << worker.name << "," << worker.address << "," << worker.clockOffsetNs << ","
+                  << worker.roundTripNs << "," << worker.operations << "," << worker.seconds << ","
+                  << worker.opsPerSecond() << std::endl;
+    }
+    std::cout << "Total Operations: " << result_.operations() << std::endl;
+    std::cout << "Throughput: " << result_.opsPerSecond() << " ops/s" << std::endl;
+    const Histogram& histogram = result_.latency;
+    if (histogram.count() > 0) {
+        std::cout << "Latency: mean " << histogram.mean() << " ns, P50 " << histogram.quantile(0.5) << " ns, P99 "
+                  << histogram.quantile(0.99) << " ns, P99.9 " << histogram.quantile(0.999) << " ns, max "
+                  << histogram.max() << " ns" << std::endl;
+    }
+}
+
+bool DistributedCoordinator::exportResults(ResultSink& sink) const {
+    bool ok = true;
+    for (const ResultTable& table : {workerTable(), latencyTable()}) {
+        if (sink.write(table)) {
+            std::cout << "Results exported to " << sink.path(table) << std::endl;
+        } else {
+            std::cerr << "Failed to export results: " << sink.error() << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+DistributedWorker::DistributedWorker(std::string host, uint16_t port, std::chrono::milliseconds timeout)
+    : host_(std::move(host)), port_(port), timeout_(timeout) {}
+
+DistributedWorker::~DistributedWorker() {
+    if (socket_ >= 0) ::close(socket_);
+}
+
+bool DistributedWorker::connect(const std::string& name) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int status = ::getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &addresses);
+    if (status != 0) return fail("resolve " + host_ + ": " + ::gai_strerror(status));
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout_;
+    while (socket_ < 0 && std::chrono::steady_clock::now() < deadline) {
+        for (addrinfo* a = addresses; a && socket_ < 0; a = a->ai_next) {
+            int fd = ::socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+                socket_ = fd;
+            } else {
+                ::close(fd);
+            }
+        }
+        if (socket_ < 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    ::freeaddrinfo(addresses);
+    if (socket_ < 0) return fail("could not reach coordinator at " + host_ + ":" + std::to_string(port_));
+    configureSocket(socket_);
+
+    PayloadWriter hello;
+    hello.putString(name);
+    return sendMessage(socket_, MessageType::Hello, hello) || fail("lost coordinator");
+}
+
+bool DistributedWorker::run(BenchmarkCore& benchmark) {
+    if (socket_ < 0) return fail("not connected");
+    benchmark.setStartBarrier([this] { waitForStart(); });
+    benchmark.run();
+    benchmark.setStartBarrier(nullptr);
+    return error_.empty() && sendResult(benchmark);
+}
+
+// Runs on the benchmark's driving thread; on a lost coordinator the phase starts unsynchronized and
+// run() reports the error afterwards.
+void DistributedWorker::waitForStart() {
+    if (!error_.empty()) return;
+    if (!sendMessage(socket_, MessageType::Ready)) {
+        fail("lost coordinator");
+        return;
+    }
+    // The first ping only comes once the slowest worker is ready; the rest of the barrier is prompt.
+    Message message;
+    std::chrono::milliseconds wait = kWholePhase;
+    while (receiveMessage(socket_, message, wait)) {
+        wait = timeout_;
+        int64_t received = nowNs();
+        PayloadReader reader(message.payload);
+        int64_t value;
+        if (!reader.getSigned(value)) break;
+        if (message.type == MessageType::Start) {
+            spinUntil(value);
+            return;
+        }
+        if (message.type != MessageType::Ping) break;
+        PayloadWriter pong;
+        pong.putSigned(value);
+        pong.putSigned(received);
+        pong.putSigned(nowNs());
+        if (!sendMessage(socket_, MessageType::Pong, pong)) break;
+    }
+    fail("lost coordinator at the start barrier");
+}
+
+bool DistributedWorker::sendResult(const BenchmarkCore& benchmark) {
+    long long operations = 0;
+    double seconds = 0.0;
+    Histogram empty, perOp;
+    const Histogram* latency = &empty;
+    if (!benchmark.throughput().workers.empty()) {
+        // Throughput mode counts operations without timing them one by one.
+        operations = benchmark.throughput().operations();
+        seconds = benchmark.throughput().seconds();
+    } else if (benchmark.openLoop().operations > 0) {
+        operations = benchmark.openLoop().operations;
+        seconds = benchmark.openLoop().seconds;
+        latency = &benchmark.openLoop().latency;
+    } else {
+        // The wall-clock window of the timed phase, so gaps between calls count against the rate.
+        latency = &benchmark.stats().histogram();
+        if (benchmark.batchSize() > 1) {
+            perOp = perOperation(*latency, static_cast<uint64_t>(benchmark.batchSize()));
+            latency = &perOp;
+        }
+        operations = static_cast<long long>(latency->count());
+        seconds = benchmark.measuredSeconds();
+    }
+
+    PayloadWriter result;
+    result.putString(benchmark.name());
+    result.putSigned(operations);
+    result.putDouble(seconds);
+    result.put(static_cast<uint64_t>(latency->precisionBits()));
+    result.put(latency->min());
+    result.put(latency->max());
+    result.putDouble(latency->sum());
+    std::vector<std::size_t> buckets;
+    for (std::size_t i = 0; i < latency->bucketCount(); ++i) {
+        if (latency->countAt(i)) buckets.push_back(i);
+    }
+    result.put(buckets.size());
+    for (std::size_t i : buckets) {
+        result.put(i);
+        result.put(latency->countAt(i));
+    }
+    return sendMessage(socket_, MessageType::Result, result) || fail("lost coordinator");
+}
+
+const std::string& DistributedWorker::error() const {
+    return error_;
+}
+
+bool DistributedWorker::fail(std::string message) {
+    if (error_.empty()) error_ = std::move(message);
+    return false;
+}
@@ -0,0 +1,122 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "benchmark_core.h"
+#include "result_sink.h"
+#include "stats.h"
+
+// Coordinator mode: one coordinator and N worker processes, usually on different machines, connected
+// over TCP. Before every timed phase the coordinator estimates each worker's steady_clock offset with
+// NTP-style ping rounds (keeping the round with the smallest round trip), then sends every worker the
+// same start instant translated into its own clock. After the run each worker streams its latency
+// histogram back and the coordinator merges them into one distribution and one throughput figure.
+
+struct DistributedOptions {
+    uint16_t port = 7878;
+    int workers = 0;     // workers to wait for; 0 means one per launched command
+    int syncRounds = 16; // ping rounds per start barrier
+    std::chrono::nanoseconds startMargin = std::chrono::milliseconds(100); // lead time on top of the slowest round trip
+    std::chrono::milliseconds timeout = std::chrono::seconds(60);         // for connects, the handshake and ping rounds
+};
+
+struct WorkerReport {
+    std::string name;    // benchmark name reported by the worker
+    std::string address; // peer address as seen by the coordinator
+    long long clockOffsetNs = 0; // worker clock minus coordinator clock at the last barrier
+    long long roundTripNs = 0;   // round trip of the ping round the offset came from
+    long long operations = 0;
+    double seconds = 0.0; // wall time of the worker's measured phase
+    Histogram latency;
+
+    double opsPerSecond() const;
+};
+
+struct DistributedResult {
+    std::vector<WorkerReport> workers;
+    Histogram latency; // every worker's histogram merged
+
+    long long operations() const;
+    double seconds() const; // longest worker window
+    // Workers run concurrently, so the global rate is the sum of their rates.
+    double opsPerSecond() const;
+};
+
+class DistributedCoordinator {
+public:
+    explicit DistributedCoordinator(DistributedOptions options = {});
+    ~DistributedCoordinator();
+    DistributedCoordinator(const DistributedCoordinator&) = delete;
+    DistributedCoordinator& operator=(const DistributedCoordinator&) = delete;
+
+    // Started through /bin/sh -c once the coordinator listens, e.g. "ssh node1 ./bench --worker coordinator:7878".
+    // Without commands the coordinator attaches to workers started by other means.
+    void addWorkerCommand(std::string command);
+
+    // Accepts the workers, runs one start barrier per timed phase they reach and collects their results.
+    // Returns false and sets error() on failure; launched commands are always waited for.
+    bool run();
+
+    const DistributedResult& result() const;
+    const std::string& error() const;
+
+    // One row per worker, and the merged histogram in the layout compare_results reads.
+    ResultTable workerTable() const;
+    ResultTable latencyTable() const;
+    void printResults() const;
+    bool exportResults(ResultSink& sink) const;
+
+private:
+    bool listen();
+    bool launch();
+    bool acceptWorkers(int count);
+    bool synchronizeStart();
+    bool collectResults();
+    void waitForLaunched();
+    void closeAll();
+    bool fail(std::string message);
+
+    DistributedOptions options_;
+    std::vector<std::string> commands_;
+    std::vector<pid_t> launched_;
+    int listenSocket_ = -1;
+    std::vector<int> sockets_;
+    DistributedResult result_;
+    std::string error_;
+};
+
+class DistributedWorker {
+public:
+    DistributedWorker(std::string host, uint16_t port, std::chrono::milliseconds timeout = std::chrono::seconds(60));
+    ~DistributedWorker();
+    DistributedWorker(const DistributedWorker&) = delete;
+    DistributedWorker& operator=(const DistributedWorker&) = delete;
+
+    // Retries until the coordinator listens or the timeout passes.
+    bool connect(const std::string& name);
+
+    // Installs the start barrier on the benchmark, runs it and sends the last phase's results:
+    // the throughput window in throughput mode, intended-start latency in open-loop mode, and the
+    // per-call histogram otherwise. Returns false and sets error() on failure.
+    bool run(BenchmarkCore& benchmark);
+
+    const std::string& error() const;
+
+private:
+    void waitForStart();
+    bool sendResult(const BenchmarkCore& benchmark);
+    bool fail(std::string message);
+
+    std::string host_;
+    uint16_t port_;
+    std::chrono::milliseconds timeout_;
+    int socket_ = -1;
+    std::string error_;
+};
+
+#endif // DISTRIBUTED_H
@@ -0,0 +1,258 @@
+#include "environment.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+const std::string kCpuRoot = "/sys/devices/system/cpu/";
+
+bool readFirstLine(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    if (!file || !std::getline(file, line)) return false;
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) line.pop_back();
+    return true;
+}
+
+std::string readTurbo() {
+    std::string value;
+    if (readFirstLine(kCpuRoot + "intel_pstate/no_turbo", value)) {
+        return value == "1" ? "disabled" : "enabled";
+    }
+    if (readFirstLine(kCpuRoot + "cpufreq/boost", value)) {
+        return value == "1" ? "enabled" : "disabled";
+    }
+    return "unknown";
+}
+
+std::string readSmt() {
+    std::string value;
+    if (readFirstLine(kCpuRoot + "smt/active", value)) {
+        return value == "1" ? "active" : "inactive";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+std::vector<std::pair<std::string, std::string>> EnvironmentReport::metadata() const {
+    return {
+        {"cpus", formatCpuList(cpus)},
+        {"pinned", pinned ? "yes" : "no"},
+        {"scheduler", realtime ? "SCHED_FIFO" : "SCHED_OTHER"},
+        {"governor", governor},
+        {"turbo", turbo},
+        {"smt", smt},
+    };
+}
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string formatCpuList(const std::vector<int>& cpus) {
+    std::vector<int> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::string list;
+    for (size_t i = 0; i < sorted.size();) {
+        size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) ++j;
+        if (!list.empty()) list += ',';
+        list += std::to_string(sorted[i]);
+        if (j > i) list += '-' + std::to_string(sorted[j]);
+        i = j + 1;
+    }
+    return list;
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+int currentCpu() {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool setRealtimeScheduling(bool enable, int priority) {
+#ifdef __linux__
+    sched_param param{};
+    param.sched_priority = enable ? priority : 0;
+    return pthread_setschedparam(pthread_self(), enable ? SCHED_FIFO : SCHED_OTHER, &param) == 0;
+#else
+    (void)enable;
+    (void)priority;
+    return false;
+#endif
+}
+
+EnvironmentReport inspectEnvironment(const std::vector<int>& cpus) {
+    EnvironmentReport report;
+    report.cpus = cpus;
+    std::sort(report.cpus.begin(), report.cpus.end());
+    report.cpus.erase(std::unique(report.cpus.begin(), report.cpus.end()), report.cpus.end());
+    report.turbo = readTurbo();
+    report.smt = readSmt();
+
+    std::map<std::string, std::vector<int>> governors;
+    std::set<int> inSet(report.cpus.begin(), report.cpus.end());
+    std::set<int> outside;
+    std::set<std::pair<int, int>> sharedCores;
+    for (int cpu : report.cpus) {
+        std::string base = kCpuRoot + "cpu" + std::to_string(cpu) + "/";
+        std::string governor;
+        if (readFirstLine(base + "cpufreq/scaling_governor", governor)) {
+            governors[governor].push_back(cpu);
+        }
+        std::string siblings;
+        if (readFirstLine(base + "topology/thread_siblings_list", siblings)) {
+            for (int sibling : parseCpuList(siblings)) {
+                if (sibling == cpu) continue;
+                if (inSet.count(sibling)) {
+                    sharedCores.insert({std::min(cpu, sibling), std::max(cpu, sibling)});
+                } else {
+                    outside.insert(sibling);
+                }
+            }
+        }
+    }
+    report.siblings.assign(outside.begin(), outside.end());
+
+    if (governors.size() == 1) {
+        report.governor = governors.begin()->first;
+    } else if (!governors.empty()) {
+        report.governor.clear();
+        for (const auto& [name, list] : governors) {
+            if (!report.governor.empty()) report.governor += ';';
+            report.governor += formatCpuList(list) + '=' + name;
+        }
+    }
+
+    for (const auto& [name, list] : governors) {
+        if (name != "performance") {
+            report.warnings.push_back("CPU frequency governor is '" + name + "' on CPUs " + formatCpuList(list) +
+                                      "; 'performance' gives more stable timings");
+        }
+    }
+    if (report.turbo == "enabled") {
+        report.warnings.push_back("Turbo boost is enabled; the clock will vary with load and temperature");
+    }
+    for (const auto& [a, b] : sharedCores) {
+        report.warnings.push_back("CPUs " + std::to_string(a) + " and " + std::to_string(b) + " are SMT siblings and share a core");
+    }
+    if (!report.siblings.empty()) {
+        report.warnings.push_back("SMT siblings " + formatCpuList(report.siblings) +
+                                  " of the measured CPUs are online; anything running there shares their cores");
+    }
+    return report;
+}
+
+void printEnvironmentWarnings(const EnvironmentReport& report) {
+    static std::set<std::string> printed;
+    for (const auto& warning : report.warnings) {
+        if (printed.insert(warning).second) {
+            std::cerr << "Warning: " << warning << std::endl;
+        }
+    }
+}
+
+ScopedThreadPlacement::ScopedThreadPlacement(const ExecutionPolicy& policy) {
+#ifdef __linux__
+    if (policy.pin) {
+        int cpu = policy.cpus.empty() ? currentCpu() : policy.cpus.front();
+        savedCpus_ = allowedCpus();
+        if (pinCurrentThread(cpu)) {
+            cpu_ = cpu;
+        } else {
+            std::cerr << "Failed to pin thread to CPU " << cpu << std::endl;
+        }
+    }
+    if (policy.realtime) {
+        sched_param param{};
+        pthread_getschedparam(pthread_self(), &savedPolicy_, &param);
+        savedPriority_ = param.sched_priority;
+        realtime_ = setRealtimeScheduling(true, policy.realtimePriority);
+        if (!realtime_) {
+            std::cerr << "Failed to enable SCHED_FIFO (needs CAP_SYS_NICE or RLIMIT_RTPRIO)" << std::endl;
+        }
+    }
+#else
+    (void)policy;
+#endif
+}
+
+ScopedThreadPlacement::~ScopedThreadPlacement() {
+#ifdef __linux__
+    if (realtime_) {
+        sched_param param{};
+        param.sched_priority = savedPriority_;
+        pthread_setschedparam(pthread_self(), savedPolicy_, &param);
+    }
+    if (cpu_ >= 0 && !savedCpus_.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : savedCpus_) CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+}
+
+int ScopedThreadPlacement::cpu() const {
+    return cpu_;
+}
+
+bool ScopedThreadPlacement::realtime() const {
+    return realtime_;
+}
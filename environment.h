@@ -0,0 +1,64 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ExecutionPolicy {
+    std::vector<int> cpus;     // CPUs to run on; empty means the process affinity mask
+    bool pin = true;           // pin the measuring thread, or each worker, to a single CPU of the set
+    bool realtime = false;     // SCHED_FIFO; needs CAP_SYS_NICE or a non-zero RLIMIT_RTPRIO
+    int realtimePriority = 1;
+};
+
+// Frequency and SMT state of a CPU set, read from /sys/devices/system/cpu.
+struct EnvironmentReport {
+    std::vector<int> cpus;
+    std::string governor = "unknown"; // one name, or "cpus=name;..." when the CPUs disagree
+    std::string turbo = "unknown";    // "enabled", "disabled" or "unknown"
+    std::string smt = "unknown";      // "active", "inactive" or "unknown"
+    std::vector<int> siblings;        // SMT siblings of the set that are not part of it
+    bool pinned = false;
+    bool realtime = false;
+    std::vector<std::string> warnings;
+
+    std::vector<std::pair<std::string, std::string>> metadata() const;
+};
+
+// Parses the kernel's CPU list syntax, e.g. "0-3,8,10-11".
+std::vector<int> parseCpuList(const std::string& list);
+std::string formatCpuList(const std::vector<int>& cpus);
+std::vector<int> allowedCpus();
+int currentCpu();
+
+// Both act on the calling thread. Return false when the kernel refuses.
+bool pinCurrentThread(int cpu);
+bool setRealtimeScheduling(bool enable, int priority = 1);
+
+EnvironmentReport inspectEnvironment(const std::vector<int>& cpus);
+// Prints each distinct warning to std::cerr once per process.
+void printEnvironmentWarnings(const EnvironmentReport& report);
+
+// Applies an ExecutionPolicy to the calling thread for its lifetime, then restores the previous
+// affinity mask and scheduling class. Without explicit CPUs the thread stays on the CPU it is running on.
+class ScopedThreadPlacement {
+public:
+    explicit ScopedThreadPlacement(const ExecutionPolicy& policy);
+    ~ScopedThreadPlacement();
+
+    ScopedThreadPlacement(const ScopedThreadPlacement&) = delete;
+    ScopedThreadPlacement& operator=(const ScopedThreadPlacement&) = delete;
+
+    int cpu() const; // -1 when not pinned
+    bool realtime() const;
+
+private:
+    std::vector<int> savedCpus_;
+    int savedPolicy_ = 0;
+    int savedPriority_ = 0;
+    int cpu_ = -1;
+    bool realtime_ = false;
+};
+
+#endif // ENVIRONMENT_H
@@ -0,0 +1,178 @@
+#ifndef FIXTURE_H
+#define FIXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// One T per thread, each in its own cache lines so neighbouring threads never share a line.
+// reset() only reserves storage; emplace() constructs in place, so calling it from the owning
+// thread makes that thread the first to touch the slot's pages.
+template <typename T>
+class PerThread {
+public:
+    static constexpr std::size_t kCacheLine = 64;
+
+    PerThread() = default;
+    explicit PerThread(int count) {
+        reset(count);
+    }
+    ~PerThread() {
+        clear();
+    }
+
+    PerThread(const PerThread&) = delete;
+    PerThread& operator=(const PerThread&) = delete;
+
+    void reset(int count) {
+        clear();
+        count = count > 0 ? count : 0;
+        slots_ = static_cast<Slot*>(::operator new(sizeof(Slot) * count, std::align_val_t(alignof(Slot))));
+        constructed_.assign(count, 0);
+        count_ = count;
+    }
+
+    template <typename... Args>
+    T& emplace(int index, Args&&... args) {
+        destroy(index);
+        T* value = new (slots_[index].storage) T(std::forward<Args>(args)...);
+        constructed_[index] = 1;
+        return *value;
+    }
+
+    void destroy(int index) {
+        if (constructed_[index]) {
+            (*this)[index].~T();
+            constructed_[index] = 0;
+        }
+    }
+
+    void clear() {
+        for (int i = 0; i < count_; ++i) {
+            destroy(i);
+        }
+        if (slots_) ::operator delete(slots_, std::align_val_t(alignof(Slot)));
+        slots_ = nullptr;
+        constructed_.clear();
+        count_ = 0;
+    }
+
+    bool constructed(int index) const {
+        return constructed_[index] != 0;
+    }
+
+    T& operator[](int index) {
+        return *std::launder(reinterpret_cast<T*>(slots_[index].storage));
+    }
+
+    const T& operator[](int index) const {
+        return *std::launder(reinterpret_cast<const T*>(slots_[index].storage));
+    }
+
+    int size() const {
+        return count_;
+    }
+
+private:
+    struct alignas(alignof(T) > kCacheLine ? alignof(T) : kCacheLine) Slot {
+        unsigned char storage[sizeof(T)];
+    };
+
+    Slot* slots_ = nullptr;
+    std::vector<uint8_t> constructed_;
+    int count_ = 0;
+};
+
+// Fixture for MultiThreadedBenchmark. setUp/tearDown run once per run on the calling thread,
+// setUpThread/tearDownThread once per run on each pinned worker, the iteration hooks around every
+// timed call on its worker, and run() is the timed body.
+class ThreadFixture {
+public:
+    virtual ~ThreadFixture() = default;
+
+    virtual void setUp(int threadCount) {
+        (void)threadCount;
+    }
+    virtual void tearDown(int threadCount) {
+        (void)threadCount;
+    }
+    virtual void setUpThread(int threadIndex, int threadCount) {
+        (void)threadIndex;
+        (void)threadCount;
+    }
+    virtual void tearDownThread(int threadIndex, int threadCount) {
+        (void)threadIndex;
+        (void)threadCount;
+    }
+    virtual void setUpIteration(int threadIndex, int threadCount) {
+        (void)threadIndex;
+        (void)threadCount;
+    }
+    virtual void tearDownIteration(int threadIndex, int threadCount) {
+        (void)threadIndex;
+        (void)threadCount;
+    }
+    virtual void run(int threadIndex, int threadCount) = 0;
+};
+
+// ThreadFixture with a framework-owned State per thread. Each State is default-constructed on its
+// own worker before setUpState; shared data belongs in the derived fixture and setUpRun.
+template <typename State>
+class ThreadStateFixture : public ThreadFixture {
+public:
+    virtual void setUpRun(int threadCount) {
+        (void)threadCount;
+    }
+    virtual void tearDownRun(int threadCount) {
+        (void)threadCount;
+    }
+    virtual void setUpState(State& state, int threadIndex, int threadCount) {
+        (void)state;
+        (void)threadIndex;
+        (void)threadCount;
+    }
+    virtual void tearDownState(State& state, int threadIndex, int threadCount) {
+        (void)state;
+        (void)threadIndex;
+        (void)threadCount;
+    }
+    virtual void runState(State& state, int threadIndex, int threadCount) = 0;
+
+    void setUp(int threadCount) final {
+        states_.reset(threadCount);
+        setUpRun(threadCount);
+    }
+
+    // States are still alive in tearDownRun, so per-thread results can be collected there.
+    void tearDown(int threadCount) final {
+        tearDownRun(threadCount);
+        states_.clear();
+    }
+
+    void setUpThread(int threadIndex, int threadCount) final {
+        setUpState(states_.emplace(threadIndex), threadIndex, threadCount);
+    }
+
+    void tearDownThread(int threadIndex, int threadCount) final {
+        tearDownState(states_[threadIndex], threadIndex, threadCount);
+    }
+
+    void run(int threadIndex, int threadCount) final {
+        runState(states_[threadIndex], threadIndex, threadCount);
+    }
+
+    State& state(int threadIndex) {
+        return states_[threadIndex];
+    }
+
+    const PerThread<State>& states() const {
+        return states_;
+    }
+
+private:
+    PerThread<State> states_;
+};
+
+#endif // FIXTURE_H
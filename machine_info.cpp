@@ -0,0 +1,254 @@
+#include "machine_info.h"
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "cold_start.h"
+#include "environment.h"
+#include "result_sink.h"
+#include "timer.h"
+
+namespace {
+
+constexpr const char* kCacheRoot = "/sys/devices/system/cpu/cpu0/cache/index";
+
+// The extensions worth knowing when comparing kernels across machines; /proc/cpuinfo lists a hundred more.
+constexpr const char* kInterestingFlags[] = {
+    "sse4_2",  "avx",      "avx2",     "fma",         "bmi1",        "bmi2",   "popcnt",    "aes",
+    "sha_ni",  "avx512f",  "avx512dq", "avx512cd",    "avx512bw",    "avx512vl", "avx512_vnni", "avx512_bf16",
+    "amx_tile", "constant_tsc", "nonstop_tsc",
+};
+
+bool readFirstLine(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    if (!file || !std::getline(file, line)) return false;
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) line.pop_back();
+    return true;
+}
+
+std::string trim(const std::string& text) {
+    std::size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    std::size_t end = text.find_last_not_of(" \t\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+// The "key : value" fields of the first processor block.
+std::map<std::string, std::string> readCpuInfo() {
+    std::map<std::string, std::string> fields;
+    std::ifstream file("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            if (!fields.empty()) break;
+            continue;
+        }
+        std::size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        fields.emplace(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+    }
+    return fields;
+}
+
+std::string field(const std::map<std::string, std::string>& fields, const char* key) {
+    auto it = fields.find(key);
+    return it != fields.end() && !it->second.empty() ? it->second : "unknown";
+}
+
+std::string readMhz(const std::map<std::string, std::string>& cpuInfo) {
+    std::string current = field(cpuInfo, "cpu MHz");
+    std::string maxKhz;
+    if (!readFirstLine("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", maxKhz)) return current;
+    try {
+        return current + " (max " + std::to_string(std::stoll(maxKhz) / 1000) + ")";
+    } catch (const std::exception&) {
+        return current;
+    }
+}
+
+std::string readCaches() {
+    std::string caches;
+    for (int index = 0;; ++index) {
+        const std::string root = kCacheRoot + std::to_string(index) + "/";
+        std::string level, type, size;
+        if (!readFirstLine(root + "level", level)) break;
+        if (!readFirstLine(root + "type", type) || !readFirstLine(root + "size", size)) continue;
+        std::string name = "L" + level;
+        if (type == "Data") name += "d";
+        if (type == "Instruction") name += "i";
+        if (!caches.empty()) caches += ";";
+        caches += name + "=" + size;
+    }
+    return caches.empty() ? "unknown" : caches;
+}
+
+std::string readIsa(const std::map<std::string, std::string>& cpuInfo) {
+    auto it = cpuInfo.find("flags");
+    if (it == cpuInfo.end()) {
+        // Arm lists a short "Features" line; keep all of it.
+        return field(cpuInfo, "Features");
+    }
+    std::set<std::string> flags;
+    std::istringstream stream(it->second);
+    for (std::string flag; stream >> flag;) flags.insert(flag);
+    std::string isa;
+    for (const char* flag : kInterestingFlags) {
+        if (!flags.count(flag)) continue;
+        if (!isa.empty()) isa += ",";
+        isa += flag;
+    }
+    return isa.empty() ? "none" : isa;
+}
+
+std::string readOs() {
+    std::ifstream file("/etc/os-release");
+    for (std::string line; std::getline(file, line);) {
+        if (line.compare(0, 12, "PRETTY_NAME=") != 0) continue;
+        std::string value = line.substr(12);
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') value = value.substr(1, value.size() - 2);
+        return value;
+    }
+    return "unknown";
+}
+
+std::string compilerName() {
+#if defined(__clang__)
+    return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+std::string buildFlags() {
+#ifdef PINNACIUM_BUILD_FLAGS
+    return PINNACIUM_BUILD_FLAGS;
+#else
+    std::string flags = "derived:";
+#if defined(__OPTIMIZE_SIZE__)
+    flags += " -Os";
+#elif defined(__OPTIMIZE__)
+    flags += " -O1+";
+#else
+    flags += " -O0";
+#endif
+#ifdef NDEBUG
+    flags += " -DNDEBUG";
+#endif
+#if defined(__AVX512F__)
+    flags += " -mavx512f";
+#elif defined(__AVX2__)
+    flags += " -mavx2";
+#elif defined(__SSE4_2__)
+    flags += " -msse4.2";
+#endif
+#ifdef __FAST_MATH__
+    flags += " -ffast-math";
+#endif
+#ifdef __SANITIZE_ADDRESS__
+    flags += " -fsanitize=address";
+#endif
+    flags += " -std=c++" + std::to_string(__cplusplus / 100 % 100);
+    return flags;
+#endif
+}
+
+std::string gitRevision() {
+#ifdef PINNACIUM_GIT_REVISION
+    return PINNACIUM_GIT_REVISION;
+#else
+    return "unknown";
+#endif
+}
+
+std::string utcNow() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+    char text[32] = "unknown";
+    if (gmtime_r(&now, &utc)) std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return text;
+}
+
+// Before main(), so the affinity recorded is the process's own rather than a pinned worker's, and the
+// timers are calibrated before anything is measured. Exec'd cold-start children never export, and
+// calibrating in each of them would only slow the pool down.
+[[maybe_unused]] const bool contextRegistered = [] {
+    if (!coldStartChildTarget()) setResultContext(machineInfo().metadata());
+    return true;
+}();
+
+} // namespace
+
+MachineInfo collectMachineInfo() {
+    MachineInfo info;
+    const auto cpuInfo = readCpuInfo();
+    info.cpuModel = field(cpuInfo, "model name");
+    info.cpuMhz = readMhz(cpuInfo);
+    info.microcode = field(cpuInfo, "microcode");
+    info.caches = readCaches();
+    info.isa = readIsa(cpuInfo);
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    info.logicalCpus = online > 0 ? static_cast<int>(online) : 0;
+    info.affinity = formatCpuList(allowedCpus());
+    info.os = readOs();
+
+    utsname name{};
+    if (uname(&name) == 0) {
+        info.kernel = std::string(name.release) + " " + name.version;
+        info.arch = name.machine;
+    }
+    char host[256] = {};
+    if (gethostname(host, sizeof(host) - 1) == 0 && host[0]) info.hostname = host;
+
+    info.compiler = compilerName();
+    info.buildFlags = buildFlags();
+    info.gitRevision = gitRevision();
+
+    if (isTscAvailable()) {
+        const TimerCalibration& tsc = timerCalibration(TimerKind::Tsc);
+        info.tsc = tsc.invariantTsc ? "invariant" : "variant";
+        info.tscGhz = tsc.nsPerTick > 0.0 ? 1.0 / tsc.nsPerTick : 0.0;
+        info.tscOverheadNs = tsc.overheadNs();
+    }
+    info.chronoOverheadNs = timerCalibration(TimerKind::Chrono).overheadNs();
+    info.capturedAt = utcNow();
+    return info;
+}
+
+const MachineInfo& machineInfo() {
+    static const MachineInfo info = collectMachineInfo();
+    return info;
+}
+
+std::vector<std::pair<std::string, std::string>> MachineInfo::metadata() const {
+    return {
+        {"machine_cpu_model", cpuModel},
+        {"machine_cpu_mhz", cpuMhz},
+        {"machine_microcode", microcode},
+        {"machine_caches", caches},
+        {"machine_isa", isa},
+        {"machine_logical_cpus", std::to_string(logicalCpus)},
+        {"machine_affinity", affinity},
+        {"machine_os", os},
+        {"machine_kernel", kernel},
+        {"machine_arch", arch},
+        {"machine_hostname", hostname},
+        {"build_compiler", compiler},
+        {"build_flags", buildFlags},
+        {"build_git_revision", gitRevision},
+        {"timer_tsc", tsc},
+        {"timer_tsc_ghz", std::to_string(tscGhz)},
+        {"timer_tsc_overhead_ns", std::to_string(tscOverheadNs)},
+        {"timer_chrono_overhead_ns", std::to_string(chronoOverheadNs)},
+        {"captured_at", capturedAt},
+    };
+}
@@ -0,0 +1,44 @@
+#ifndef MACHINE_INFO_H
+#define MACHINE_INFO_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// What produced a result file: the machine, the build and the timers. Collected once per process at
+// startup, cached, and registered as the result context (result_sink.h) so every sink writes it.
+//
+// The compiler flags and git revision cannot be read back from a binary; pass them at build time with
+// -DPINNACIUM_BUILD_FLAGS="\"...\"" and -DPINNACIUM_GIT_REVISION="\"$(git rev-parse --short HEAD)\"".
+// Without PINNACIUM_BUILD_FLAGS the flags are reconstructed from the predefined macros of this file's
+// translation unit.
+struct MachineInfo {
+    std::string cpuModel = "unknown";
+    std::string cpuMhz = "unknown";    // nominal and maximum, from /proc/cpuinfo and cpufreq
+    std::string microcode = "unknown";
+    std::string caches = "unknown";    // cpu0's view, e.g. "L1d=48K;L1i=32K;L2=2048K;L3=36864K"
+    std::string isa = "unknown";       // the vector and bit-manipulation extensions the CPU reports
+    int logicalCpus = 0;               // online CPUs
+    std::string affinity;              // the process affinity mask at startup
+    std::string os = "unknown";        // PRETTY_NAME from /etc/os-release
+    std::string kernel = "unknown";    // uname release and version
+    std::string arch = "unknown";
+    std::string hostname = "unknown";
+    std::string compiler;
+    std::string buildFlags;
+    std::string gitRevision;
+    std::string tsc = "unavailable"; // "invariant", "variant" or "unavailable"
+    double tscGhz = 0.0;
+    double tscOverheadNs = 0.0;
+    double chronoOverheadNs = 0.0;
+    std::string capturedAt; // UTC, ISO 8601
+
+    // Keys prefixed machine_, build_ and timer_, plus captured_at.
+    std::vector<std::pair<std::string, std::string>> metadata() const;
+};
+
+MachineInfo collectMachineInfo();
+// The startup snapshot; collected on first use if called during static initialization.
+const MachineInfo& machineInfo();
+
+#endif // MACHINE_INFO_H
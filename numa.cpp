@@ -0,0 +1,119 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+#include "environment.h"
+
+namespace {
+
+NumaTopology readTopology() {
+    NumaTopology topology;
+#ifdef __linux__
+    const std::string root = "/sys/devices/system/node/";
+    if (DIR* dir = opendir(root.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+                !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                continue;
+            }
+            std::ifstream file(root + name + "/cpulist");
+            std::string list;
+            if (!std::getline(file, list)) continue;
+            NumaNode node;
+            node.id = std::stoi(name.substr(4));
+            node.cpus = parseCpuList(list);
+            if (!node.cpus.empty()) topology.nodes.push_back(std::move(node));
+        }
+        closedir(dir);
+    }
+#endif
+    std::sort(topology.nodes.begin(), topology.nodes.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    if (topology.nodes.empty()) {
+        NumaNode node;
+        node.cpus = allowedCpus();
+        topology.nodes.push_back(std::move(node));
+    }
+    return topology.restrictedTo(allowedCpus());
+}
+
+} // namespace
+
+int NumaTopology::nodeOfCpu(int cpu) const {
+    for (const auto& node : nodes) {
+        if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) return node.id;
+    }
+    return -1;
+}
+
+NumaTopology NumaTopology::restrictedTo(const std::vector<int>& cpus) const {
+    std::vector<int> allowed = cpus;
+    std::sort(allowed.begin(), allowed.end());
+
+    NumaTopology topology;
+    for (const auto& node : nodes) {
+        NumaNode restricted;
+        restricted.id = node.id;
+        std::set_intersection(node.cpus.begin(), node.cpus.end(), allowed.begin(), allowed.end(),
+                              std::back_inserter(restricted.cpus));
+        if (!restricted.cpus.empty()) topology.nodes.push_back(std::move(restricted));
+    }
+    return topology;
+}
+
+const char* placementName(PlacementPolicy policy) {
+    switch (policy) {
+    case PlacementPolicy::Compact:
+        return "compact";
+    case PlacementPolicy::Scatter:
+        return "scatter";
+    case PlacementPolicy::PerNode:
+        return "per-node";
+    }
+    return "unknown";
+}
+
+const NumaTopology& numaTopology() {
+    static const NumaTopology topology = readTopology();
+    return topology;
+}
+
+std::vector<int> placeThreads(const NumaTopology& topology, PlacementPolicy policy, int threads, int node) {
+    std::vector<int> order;
+    switch (policy) {
+    case PlacementPolicy::Compact:
+        for (const auto& n : topology.nodes) {
+            order.insert(order.end(), n.cpus.begin(), n.cpus.end());
+        }
+        break;
+    case PlacementPolicy::Scatter: {
+        size_t longest = 0;
+        for (const auto& n : topology.nodes) longest = std::max(longest, n.cpus.size());
+        for (size_t i = 0; i < longest; ++i) {
+            for (const auto& n : topology.nodes) {
+                if (i < n.cpus.size()) order.push_back(n.cpus[i]);
+            }
+        }
+        break;
+    }
+    case PlacementPolicy::PerNode:
+        for (const auto& n : topology.nodes) {
+            if (n.id == node) order = n.cpus;
+        }
+        break;
+    }
+
+    std::vector<int> cpus;
+    if (order.empty()) return cpus;
+    for (int t = 0; t < threads; ++t) {
+        cpus.push_back(order[t % order.size()]);
+    }
+    return cpus;
+}
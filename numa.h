@@ -0,0 +1,34 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <vector>
+
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+struct NumaTopology {
+    std::vector<NumaNode> nodes;
+
+    int nodeOfCpu(int cpu) const; // -1 when the CPU belongs to no known node
+    // Nodes restricted to the given CPUs; nodes left without CPUs are dropped.
+    NumaTopology restrictedTo(const std::vector<int>& cpus) const;
+};
+
+enum class PlacementPolicy {
+    Compact, // fill one node before moving to the next
+    Scatter, // round-robin threads across nodes
+    PerNode, // keep every thread on a single node
+};
+
+const char* placementName(PlacementPolicy policy);
+
+// Read once from /sys/devices/system/node. Without NUMA support this is a single node 0 holding all allowed CPUs.
+const NumaTopology& numaTopology();
+
+// Returns one CPU per thread (wrapping when threads outnumber CPUs), drawn from the CPUs of the given topology.
+// node selects the node for PerNode and is ignored otherwise. Empty if the topology or the node has no CPUs.
+std::vector<int> placeThreads(const NumaTopology& topology, PlacementPolicy policy, int threads, int node = 0);
+
+#endif // NUMA_H
@@ -0,0 +1,64 @@
+#include "open_loop.h"
+
+#include <algorithm>
+#include <iostream>
+
+const char* arrivalScheduleName(ArrivalSchedule schedule) {
+    switch (schedule) {
+    case ArrivalSchedule::Fixed:
+        return "fixed";
+    case ArrivalSchedule::Poisson:
+        return "poisson";
+    }
+    return "unknown";
+}
+
+ArrivalClock::ArrivalClock(ArrivalSchedule schedule, double ratePerSecond, uint64_t seed, double offsetNs)
+    : schedule_(schedule), intervalNs_(ratePerSecond > 0.0 ? 1e9 / ratePerSecond : 1e9), nextNs_(offsetNs), rng_(seed),
+      gap_(1.0 / intervalNs_) {}
+
+double ArrivalClock::intervalNs() const {
+    return intervalNs_;
+}
+
+double ArrivalClock::next() {
+    double intended = nextNs_;
+    nextNs_ += schedule_ == ArrivalSchedule::Poisson ? gap_(rng_) : intervalNs_;
+    return intended;
+}
+
+void OpenLoopResult::merge(const OpenLoopResult& other) {
+    latency.merge(other.latency);
+    serviceTime.merge(other.serviceTime);
+    operations += other.operations;
+    late += other.late;
+    seconds = std::max(seconds, other.seconds);
+}
+
+void OpenLoopResult::clear() {
+    latency.clear();
+    serviceTime.clear();
+    operations = 0;
+    late = 0;
+    seconds = 0.0;
+}
+
+double OpenLoopResult::achievedRate() const {
+    return seconds > 0.0 ? static_cast<double>(operations) / seconds : 0.0;
+}
+
+void printOpenLoop(const OpenLoopOptions& options, const OpenLoopResult& result) {
+    std::cout << "Schedule: " << arrivalScheduleName(options.schedule) << " at " << options.rate << " ops/s" << std::endl;
+    std::cout << "Achieved Rate: " << result.achievedRate() << " ops/s" << std::endl;
+    std::cout << "Operations: " << result.operations << " (" << result.late << " started late)" << std::endl;
+
+    const Histogram* histograms[] = {&result.latency, &result.serviceTime};
+    const char* labels[] = {"Latency", "Service Time"};
+    for (int i = 0; i < 2; ++i) {
+        const Histogram& histogram = *histograms[i];
+        if (histogram.count() == 0) continue;
+        std::cout << labels[i] << ": mean " << histogram.mean() << " ns, P50 " << histogram.quantile(0.5)
+                  << " ns, P99 " << histogram.quantile(0.99) << " ns, P99.9 " << histogram.quantile(0.999)
+                  << " ns, P99.99 " << histogram.quantile(0.9999) << " ns, max " << histogram.max() << " ns" << std::endl;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef OPEN_LOOP_H
+#define OPEN_LOOP_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+#include "stats.h"
+
+enum class ArrivalSchedule {
+    Fixed,   // evenly spaced arrivals
+    Poisson, // exponentially distributed gaps with the same mean
+};
+
+struct OpenLoopOptions {
+    double rate = 1000.0; // target operations per second across all threads
+    ArrivalSchedule schedule = ArrivalSchedule::Fixed;
+    std::chrono::nanoseconds duration = std::chrono::seconds(5);
+    uint64_t seed = 0x5eed;
+};
+
+const char* arrivalScheduleName(ArrivalSchedule schedule);
+
+// Intended start times for one issuing thread, in nanoseconds from the start of the run.
+class ArrivalClock {
+public:
+    // offsetNs shifts the first arrival, so fixed-rate threads can be spread across one interval.
+    ArrivalClock(ArrivalSchedule schedule, double ratePerSecond, uint64_t seed, double offsetNs = 0.0);
+
+    double intervalNs() const;
+
+    // Returns the current intended start and advances to the next one.
+    double next();
+
+private:
+    ArrivalSchedule schedule_;
+    double intervalNs_;
+    double nextNs_ = 0.0;
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> gap_;
+};
+
+// Latency runs from the intended start, so time spent waiting behind a stalled call is counted;
+// service time runs from the actual start and is what a closed loop would have reported.
+struct OpenLoopResult {
+    Histogram latency;
+    Histogram serviceTime;
+    long long operations = 0;
+    long long late = 0; // operations that started more than a microsecond after their intended time
+    double seconds = 0.0;
+
+    void merge(const OpenLoopResult& other);
+    void clear();
+    double achievedRate() const;
+};
+
+void printOpenLoop(const OpenLoopOptions& options, const OpenLoopResult& result);
+
+#endif // OPEN_LOOP_H
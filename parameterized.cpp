@@ -0,0 +1,155 @@
+#include "parameterized.h"
+
+#include <iostream>
+#include <map>
+
+std::vector<int64_t> argumentRange(int64_t lo, int64_t hi, int64_t multiplier) {
+    std::vector<int64_t> values;
+    if (hi < lo) return values;
+    values.push_back(lo);
+    if (multiplier < 2) multiplier = 2;
+    for (int64_t value = 1; value < hi; value *= multiplier) {
+        if (value > lo) values.push_back(value);
+        if (value > hi / multiplier) break;
+    }
+    if (hi != lo) values.push_back(hi);
+    return values;
+}
+
+std::vector<int64_t> denseArgumentRange(int64_t lo, int64_t hi, int64_t step) {
+    std::vector<int64_t> values;
+    if (step < 1) step = 1;
+    for (int64_t value = lo; value <= hi; value += step) {
+        values.push_back(value);
+    }
+    return values;
+}
+
+std::vector<BenchmarkArgs> cartesianProduct(const std::vector<std::vector<int64_t>>& axes) {
+    std::vector<BenchmarkArgs> product(1);
+    for (const auto& axis : axes) {
+        std::vector<BenchmarkArgs> next;
+        next.reserve(product.size() * axis.size());
+        for (const auto& prefix : product) {
+            for (int64_t value : axis) {
+                next.push_back(prefix);
+                next.back().push_back(value);
+            }
+        }
+        product.swap(next);
+    }
+    return axes.empty() ? std::vector<BenchmarkArgs>() : product;
+}
+
+ParameterizedBenchmark::ParameterizedBenchmark(std::string name, Function fn, int iterations, int warmup)
+    : name_(std::move(name)), function_(std::move(fn)), iterations_(iterations), warmup_(warmup) {}
+
+ParameterizedBenchmark& ParameterizedBenchmark::args(BenchmarkArgs args) {
+    argumentSets_.push_back(std::move(args));
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::range(int64_t lo, int64_t hi, int64_t multiplier) {
+    for (int64_t value : argumentRange(lo, hi, multiplier)) {
+        argumentSets_.push_back({value});
+    }
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::denseRange(int64_t lo, int64_t hi, int64_t step) {
+    for (int64_t value : denseArgumentRange(lo, hi, step)) {
+        argumentSets_.push_back({value});
+    }
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::ranges(const std::vector<std::vector<int64_t>>& axes) {
+    for (auto& args : cartesianProduct(axes)) {
+        argumentSets_.push_back(std::move(args));
+    }
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::complexityArgument(std::size_t index) {
+    complexityArgument_ = index;
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::setArgumentSetup(ArgumentFunction setup) {
+    argumentSetup_ = std::move(setup);
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::setArgumentTeardown(ArgumentFunction teardown) {
+    argumentTeardown_ = std::move(teardown);
+    return *this;
+}
+
+ParameterizedBenchmark& ParameterizedBenchmark::configure(Configure configure) {
+    configure_ = std::move(configure);
+    return *this;
+}
+
+void ParameterizedBenchmark::run() {
+    std::vector<double> perOpNs;
+    perOpNs.reserve(argumentSets_.size());
+    for (const auto& args : argumentSets_) {
+        if (argumentSetup_) argumentSetup_(args);
+
+        Function function = function_;
+        Benchmark bench(argumentName(name_, args), [function, args] { function(args); }, iterations_, warmup_);
+        if (configure_) configure_(bench);
+        bench.run();
+        perOpNs.push_back(bench.stats().running().mean() / static_cast<double>(bench.batchSize()));
+
+        if (argumentTeardown_) argumentTeardown_(args);
+    }
+    printComplexity(perOpNs);
+}
+
+const std::vector<BenchmarkArgs>& ParameterizedBenchmark::argumentSets() const {
+    return argumentSets_;
+}
+
+std::string ParameterizedBenchmark::argumentName(const std::string& name, const BenchmarkArgs& args) {
+    std::string result = name;
+    for (int64_t arg : args) {
+        result += "/" + std::to_string(arg);
+    }
+    return result;
+}
+
+void ParameterizedBenchmark::printComplexity(const std::vector<double>& perOpNs) const {
+    std::map<BenchmarkArgs, std::pair<std::vector<int64_t>, std::vector<double>>> groups;
+    for (std::size_t i = 0; i < argumentSets_.size(); ++i) {
+        const auto& args = argumentSets_[i];
+        if (complexityArgument_ >= args.size()) continue;
+        BenchmarkArgs key = args;
+        key.erase(key.begin() + static_cast<std::ptrdiff_t>(complexityArgument_));
+        groups[key].first.push_back(args[complexityArgument_]);
+        groups[key].second.push_back(perOpNs[i]);
+    }
+
+    for (const auto& group : groups) {
+        const auto& n = group.second.first;
+        const auto& time = group.second.second;
+        if (n.size() < 3) continue;
+
+        std::string name = name_;
+        for (std::size_t a = 0; a <= group.first.size(); ++a) {
+            if (a == complexityArgument_) name += "/n";
+            if (a < group.first.size()) name += "/" + std::to_string(group.first[a]);
+        }
+
+        ComplexityFit best = bestComplexityFit(n, time);
+        std::cout << "Complexity: " << name << std::endl;
+        for (Complexity complexity : allComplexities()) {
+            ComplexityFit fit = fitComplexity(n, time, complexity);
+            std::cout << "  " << complexityName(complexity) << ": coefficient " << fit.coefficient
+                      << " ns, RMS " << fit.rms * 100.0 << "%" << std::endl;
+        }
+        std::cout << "Best Fit: " << complexityName(best.complexity) << " (coefficient " << best.coefficient
+                  << " ns, RMS " << best.rms * 100.0 << "%)" << std::endl;
+        std::cout << "=========================" << std::endl;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef PARAMETERIZED_H
+#define PARAMETERIZED_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "complexity.h"
+
+using BenchmarkArgs = std::vector<int64_t>;
+
+// lo, then every power of multiplier strictly between lo and hi, then hi.
+std::vector<int64_t> argumentRange(int64_t lo, int64_t hi, int64_t multiplier = 8);
+std::vector<int64_t> denseArgumentRange(int64_t lo, int64_t hi, int64_t step = 1);
+std::vector<BenchmarkArgs> cartesianProduct(const std::vector<std::vector<int64_t>>& axes);
+
+// Runs one Benchmark per argument set (named "name/arg0/arg1...") and fits the mean per-op time
+// against O(1) .. O(n^2) over the complexity argument, separately for each combination of the other arguments.
+class ParameterizedBenchmark {
+public:
+    using Function = std::function<void(const BenchmarkArgs&)>;
+    using ArgumentFunction = std::function<void(const BenchmarkArgs&)>;
+    using Configure = std::function<void(Benchmark&)>;
+
+    ParameterizedBenchmark(std::string name, Function fn, int iterations = 100, int warmup = 10);
+
+    ParameterizedBenchmark& args(BenchmarkArgs args);
+    ParameterizedBenchmark& range(int64_t lo, int64_t hi, int64_t multiplier = 8);
+    ParameterizedBenchmark& denseRange(int64_t lo, int64_t hi, int64_t step = 1);
+    ParameterizedBenchmark& ranges(const std::vector<std::vector<int64_t>>& axes);
+    ParameterizedBenchmark& complexityArgument(std::size_t index);
+    // Runs once per argument set, outside any timed region, e.g. to allocate an input of size args[0].
+    ParameterizedBenchmark& setArgumentSetup(ArgumentFunction setup);
+    ParameterizedBenchmark& setArgumentTeardown(ArgumentFunction teardown);
+    // Applied to every generated Benchmark before it runs (batching, counters, timer, ...).
+    ParameterizedBenchmark& configure(Configure configure);
+
+    void run();
+
+    const std::vector<BenchmarkArgs>& argumentSets() const;
+    static std::string argumentName(const std::string& name, const BenchmarkArgs& args);
+
+private:
+    void printComplexity(const std::vector<double>& perOpNs) const;
+
+    std::string name_;
+    Function function_;
+    int iterations_;
+    int warmup_;
+    std::size_t complexityArgument_ = 0;
+    std::vector<BenchmarkArgs> argumentSets_;
+    ArgumentFunction argumentSetup_;
+    ArgumentFunction argumentTeardown_;
+    Configure configure_;
+};
+
+#endif // PARAMETERIZED_H
@@ -0,0 +1,265 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc
+#endif
+
+namespace {
+
+#ifdef __linux__
+struct EventCode {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+const EventCode kEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {"stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {"ref-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+    {"l1d-loads", PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+    {"l1d-misses", PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"llc-loads", PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+    {"llc-misses", PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"dtlb-misses", PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+bool lookupEvent(const std::string& name, uint32_t& type, uint64_t& config) {
+    for (const auto& event : kEvents) {
+        if (name == event.name) {
+            type = event.type;
+            config = event.config;
+            return true;
+        }
+    }
+    if (name.size() > 1 && name[0] == 'r') {
+        char* end = nullptr;
+        config = std::strtoull(name.c_str() + 1, &end, 16);
+        type = PERF_TYPE_RAW;
+        return end && *end == '\0';
+    }
+    return false;
+}
+
+int perfEventOpen(perf_event_attr* attr, int groupFd) {
+    return static_cast<int>(syscall(SYS_perf_event_open, attr, 0, -1, groupFd, 0));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+inline uint64_t rdpmc(uint32_t counter) {
+    uint32_t low, high;
+    __asm__ volatile ("rdpmc" : "=a" (low), "=d" (high) : "c" (counter));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+#endif
+#endif
+
+} // namespace
+
+std::vector<std::string> PerfCounters::defaultEvents() {
+    return {"cycles", "instructions", "l1d-misses", "llc-misses", "branch-misses"};
+}
+
+bool PerfCounters::isKnownEvent(const std::string& event) {
+#ifdef __linux__
+    uint32_t type;
+    uint64_t config;
+    return lookupEvent(event, type, config);
+#else
+    (void)event;
+    return false;
+#endif
+}
+
+PerfCounters::PerfCounters(std::vector<std::string> events)
+    : events_(std::move(events)), startReadings_(events_.size()) {}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+bool PerfCounters::open(bool enable) {
+    close();
+#ifdef __linux__
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for (std::size_t i = 0; i < events_.size(); ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        uint64_t config = 0;
+        if (!lookupEvent(events_[i], attr.type, config)) {
+            error_ = "unknown event '" + events_[i] + "'";
+            close();
+            return false;
+        }
+        attr.config = config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        bool leader = i % kMaxGroupEvents == 0;
+        attr.disabled = leader ? 1 : 0;
+        int fd = perfEventOpen(&attr, leader ? -1 : counters_[groupLeaders_.back()].fd);
+        if (fd < 0) {
+            error_ = "perf_event_open(" + events_[i] + "): " + std::strerror(errno);
+            close();
+            return false;
+        }
+        if (leader) groupLeaders_.push_back(static_cast<int>(i));
+
+        Counter counter;
+        counter.fd = fd;
+        void* page = mmap(nullptr, static_cast<std::size_t>(pageSize), PROT_READ, MAP_SHARED, fd, 0);
+        counter.page = page == MAP_FAILED ? nullptr : page;
+        counters_.push_back(counter);
+    }
+    for (int leader : groupLeaders_) {
+        ioctl(counters_[leader].fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+    open_ = true;
+    if (enable) this->enable();
+    return true;
+#else
+    (void)enable;
+    error_ = "perf_event_open is only available on Linux";
+    return false;
+#endif
+}
+
+void PerfCounters::close() {
+#ifdef __linux__
+    long pageSize = sysconf(_SC_PAGESIZE);
+    for (auto& counter : counters_) {
+        if (counter.page) munmap(counter.page, static_cast<std::size_t>(pageSize));
+        if (counter.fd >= 0) ::close(counter.fd);
+    }
+#endif
+    counters_.clear();
+    groupLeaders_.clear();
+    open_ = false;
+}
+
+bool PerfCounters::isOpen() const {
+    return open_;
+}
+
+void PerfCounters::enable() {
+#ifdef __linux__
+    for (int leader : groupLeaders_) {
+        ioctl(counters_[leader].fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+void PerfCounters::disable() {
+#ifdef __linux__
+    for (int leader : groupLeaders_) {
+        ioctl(counters_[leader].fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+void PerfCounters::start() {
+    for (std::size_t i = 0; i < counters_.size(); ++i) {
+        startReadings_[i] = read(counters_[i]);
+    }
+}
+
+void PerfCounters::stop(uint64_t* deltas) {
+    for (std::size_t i = 0; i < counters_.size(); ++i) {
+        Reading end = read(counters_[i]);
+        const Reading& begin = startReadings_[i];
+        uint64_t count = end.count - begin.count;
+        uint64_t enabled = end.enabled - begin.enabled;
+        uint64_t running = end.running - begin.running;
+        if (running == 0) {
+            deltas[i] = 0;
+        } else if (running < enabled) {
+            deltas[i] = static_cast<uint64_t>(static_cast<double>(count) * enabled / running);
+        } else {
+            deltas[i] = count;
+        }
+    }
+}
+
+std::size_t PerfCounters::size() const {
+    return events_.size();
+}
+
+const std::vector<std::string>& PerfCounters::events() const {
+    return events_;
+}
+
+const std::string& PerfCounters::error() const {
+    return error_;
+}
+
+PerfCounters::Reading PerfCounters::read(const Counter& counter) const {
+    Reading reading;
+#ifdef __linux__
+#if defined(__x86_64__) || defined(__i386__)
+    if (counter.page) {
+        auto* page = static_cast<volatile perf_event_mmap_page*>(counter.page);
+        uint32_t sequence;
+        bool userspace;
+        do {
+            sequence = page->lock;
+            __asm__ volatile ("" ::: "memory");
+            reading.enabled = page->time_enabled;
+            reading.running = page->time_running;
+            uint32_t index = page->index;
+            userspace = page->cap_user_rdpmc && index != 0;
+            if (userspace) {
+                uint16_t width = page->pmc_width;
+                int64_t pmc = static_cast<int64_t>(rdpmc(index - 1) << (64 - width)) >> (64 - width);
+                reading.count = static_cast<uint64_t>(page->offset + pmc);
+            }
+            if (page->cap_user_time) {
+                uint64_t cycles = __rdtsc();
+                uint16_t shift = page->time_shift;
+                uint32_t mult = page->time_mult;
+                uint64_t quot = cycles >> shift;
+                uint64_t rem = cycles & ((static_cast<uint64_t>(1) << shift) - 1);
+                uint64_t delta = page->time_offset + quot * mult + ((rem * mult) >> shift);
+                reading.enabled += delta;
+                if (index != 0) reading.running += delta;
+            }
+            __asm__ volatile ("" ::: "memory");
+        } while (page->lock != sequence);
+        if (userspace) return reading;
+    }
+#endif
+    uint64_t values[3] = {0, 0, 0};
+    if (::read(counter.fd, values, sizeof(values)) == static_cast<ssize_t>(sizeof(values))) {
+        reading.count = values[0];
+        reading.enabled = values[1];
+        reading.running = values[2];
+    }
+#else
+    (void)counter;
+#endif
+    return reading;
+}
@@ -0,0 +1,67 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-thread hardware counters opened through perf_event_open (Linux only).
+// Events are packed into groups that the kernel schedules together; values are
+// read in userspace with rdpmc when the mmap page allows it and scaled for multiplexing.
+class PerfCounters {
+public:
+    static constexpr std::size_t kMaxGroupEvents = 4;
+
+    // Accepts "cycles", "instructions", "branches", "branch-misses", "cache-references",
+    // "cache-misses", "l1d-loads", "l1d-misses", "llc-loads", "llc-misses", "dtlb-misses",
+    // "stalled-cycles-frontend", "stalled-cycles-backend", "ref-cycles", the software events
+    // "task-clock", "page-faults", "context-switches" and raw "r<hex>" codes.
+    static std::vector<std::string> defaultEvents();
+    static bool isKnownEvent(const std::string& event);
+
+    explicit PerfCounters(std::vector<std::string> events = defaultEvents());
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Opens the counters for the calling thread, counting right away unless enable is false.
+    // Returns false and sets error() on failure.
+    bool open(bool enable = true);
+    void close();
+    bool isOpen() const;
+    // One ioctl per group; lets several counter sets take turns on the PMU instead of being multiplexed.
+    void enable();
+    void disable();
+
+    void start();
+    // Writes one multiplexing-scaled delta per event since the last start().
+    void stop(uint64_t* deltas);
+
+    std::size_t size() const;
+    const std::vector<std::string>& events() const;
+    const std::string& error() const;
+
+private:
+    struct Reading {
+        uint64_t count = 0;
+        uint64_t enabled = 0;
+        uint64_t running = 0;
+    };
+
+    struct Counter {
+        int fd = -1;
+        void* page = nullptr;
+    };
+
+    Reading read(const Counter& counter) const;
+
+    std::vector<std::string> events_;
+    std::vector<Counter> counters_;
+    std::vector<int> groupLeaders_;
+    std::vector<Reading> startReadings_;
+    std::string error_;
+    bool open_ = false;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,395 @@
+#include "probes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <utility>
+
+#include "benchmark.h"
+#include "cache_control.h"
+#include "registry.h"
+#include "timer.h"
+
+namespace {
+
+std::string formatBytes(std::size_t bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB"};
+    int unit = 0;
+    while (unit < 3 && bytes >= 1024 && bytes % 1024 == 0) {
+        bytes /= 1024;
+        ++unit;
+    }
+    return std::to_string(bytes) + units[unit];
+}
+
+// One pointer per cache line, linked in a single random cycle (Sattolo's algorithm) so every load
+// depends on the previous one and the prefetchers cannot guess the next line.
+class ChaseRing {
+public:
+    ChaseRing(std::size_t bytes, uint64_t seed) : nodes_(std::max<std::size_t>(bytes / sizeof(Node), 2)) {
+        std::vector<uint32_t> order(nodes_.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::mt19937_64 rng(seed);
+        for (std::size_t i = order.size() - 1; i > 0; --i) {
+            std::uniform_int_distribution<std::size_t> pick(0, i - 1);
+            std::swap(order[i], order[pick(rng)]);
+        }
+        for (std::size_t i = 0; i < order.size(); ++i) nodes_[i].next = &nodes_[order[i]];
+        cursor_ = &nodes_[0];
+    }
+
+    void walk(int hops) {
+        const Node* node = cursor_;
+        for (int h = 0; h < hops; ++h) node = node->next;
+        cursor_ = node;
+    }
+
+private:
+    struct alignas(64) Node {
+        const Node* next;
+    };
+
+    std::vector<Node> nodes_;
+    const Node* cursor_;
+};
+
+enum class StreamKernel {
+    Copy,  // c = a
+    Scale, // b = s * c
+    Add,   // c = a + b
+    Triad, // a = b + s * c
+};
+
+const char* streamKernelName(StreamKernel kernel) {
+    switch (kernel) {
+    case StreamKernel::Copy:
+        return "copy";
+    case StreamKernel::Scale:
+        return "scale";
+    case StreamKernel::Add:
+        return "add";
+    case StreamKernel::Triad:
+        return "triad";
+    }
+    return "unknown";
+}
+
+// Bytes read and written per element, counted as STREAM does (no write-allocate traffic).
+std::size_t streamBytesPerElement(StreamKernel kernel) {
+    return kernel == StreamKernel::Copy || kernel == StreamKernel::Scale ? 2 * sizeof(double) : 3 * sizeof(double);
+}
+
+// Every worker owns the slice [n * t / threads, n * (t + 1) / threads) of each array and initializes
+// it itself, so with a single sweep point its pages are first touched on its own node.
+class StreamFixture : public ThreadFixture {
+public:
+    StreamFixture(StreamKernel kernel, std::size_t elements)
+        : kernel_(kernel), elements_(elements), a_(new double[elements]), b_(new double[elements]), c_(new double[elements]) {}
+
+    std::size_t bytesPerCall() const {
+        return elements_ * streamBytesPerElement(kernel_);
+    }
+
+    void setUpThread(int threadIndex, int threadCount) override {
+        auto [begin, end] = slice(threadIndex, threadCount);
+        for (std::size_t i = begin; i < end; ++i) {
+            a_[i] = 1.0;
+            b_[i] = 2.0;
+            c_[i] = 0.0;
+        }
+    }
+
+    void run(int threadIndex, int threadCount) override {
+        auto [begin, end] = slice(threadIndex, threadCount);
+        double* __restrict a = a_.get();
+        double* __restrict b = b_.get();
+        double* __restrict c = c_.get();
+        const double s = 3.0;
+        switch (kernel_) {
+        case StreamKernel::Copy:
+            for (std::size_t i = begin; i < end; ++i) c[i] = a[i];
+            break;
+        case StreamKernel::Scale:
+            for (std::size_t i = begin; i < end; ++i) b[i] = s * c[i];
+            break;
+        case StreamKernel::Add:
+            for (std::size_t i = begin; i < end; ++i) c[i] = a[i] + b[i];
+            break;
+        case StreamKernel::Triad:
+            for (std::size_t i = begin; i < end; ++i) a[i] = b[i] + s * c[i];
+            break;
+        }
+        clobberMemory();
+    }
+
+private:
+    std::pair<std::size_t, std::size_t> slice(int threadIndex, int threadCount) const {
+        return {elements_ * threadIndex / threadCount, elements_ * (threadIndex + 1) / threadCount};
+    }
+
+    StreamKernel kernel_;
+    std::size_t elements_;
+    std::unique_ptr<double[]> a_;
+    std::unique_ptr<double[]> b_;
+    std::unique_ptr<double[]> c_;
+};
+
+// Worker 0 writes odd values and waits for the following even one, worker 1 answers; each handoff
+// moves the line between the two cores. Both workers run the same number of calls, so each derives
+// the sequence numbers of its call from its own call count.
+class PingPongFixture : public ThreadFixture {
+public:
+    explicit PingPongFixture(int rounds) : rounds_(static_cast<uint64_t>(rounds)) {}
+
+    void run(int threadIndex, int) override {
+        const uint64_t base = calls_[threadIndex].value++ * 2 * rounds_;
+        if (threadIndex == 0) {
+            for (uint64_t r = 0; r < rounds_; ++r) {
+                line_.store(base + 2 * r + 1, std::memory_order_release);
+                while (line_.load(std::memory_order_acquire) != base + 2 * r + 2) cpuRelax();
+            }
+        } else {
+            for (uint64_t r = 0; r < rounds_; ++r) {
+                while (line_.load(std::memory_order_acquire) != base + 2 * r + 1) cpuRelax();
+                line_.store(base + 2 * r + 2, std::memory_order_release);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) CallCount {
+        uint64_t value = 0;
+    };
+
+    uint64_t rounds_;
+    alignas(64) std::atomic<uint64_t> line_{0};
+    CallCount calls_[2];
+};
+
+void registerLatencyProbes(const ProbeOptions& options) {
+    for (std::size_t bytes = options.minWorkingSet; bytes <= options.maxWorkingSet; bytes *= 2) {
+        std::string name = "probe/latency/" + formatBytes(bytes);
+        BenchmarkRegistry::instance().add(name, "probe", [options, bytes, name] {
+            auto ring = std::make_shared<ChaseRing>(bytes, 0x9e3779b97f4a7c15ULL ^ bytes);
+            const int hops = std::max(options.hopsPerCall, 1);
+            Benchmark benchmark(name, [ring, hops] { ring->walk(hops); }, options.iterations, options.warmup);
+            benchmark.setResultFormat(ResultFormat::Csv, options.resultDirectory);
+            benchmark.run();
+            probeReport().latency.push_back({bytes, benchmark.stats().quantile(0.5) / hops, 0.0});
+        });
+    }
+}
+
+void registerStreamProbes(const ProbeOptions& options) {
+    std::size_t arrayBytes = options.streamArrayBytes;
+    if (arrayBytes == 0) arrayBytes = std::max<std::size_t>(4 * lastLevelCacheSize(), 32u << 20);
+    const std::size_t elements = arrayBytes / sizeof(double);
+    const int maxThreads = std::max(options.maxThreads, 1);
+
+    for (StreamKernel kernel : {StreamKernel::Copy, StreamKernel::Scale, StreamKernel::Add, StreamKernel::Triad}) {
+        std::string name = std::string("probe/stream/") + streamKernelName(kernel);
+        BenchmarkRegistry::instance().add(name, "probe", [options, kernel, elements, maxThreads, name] {
+            auto fixture = std::make_shared<StreamFixture>(kernel, elements);
+            MultiThreadedBenchmark benchmark(name, fixture, options.iterations, options.warmup, maxThreads);
+            benchmark.enableThreadSweep();
+            benchmark.setResultFormat(ResultFormat::Csv, options.resultDirectory);
+            benchmark.run();
+            // Throughput counts one slice per worker, so a slice's bytes convert it to bytes per second.
+            for (const ScalingPoint& point : benchmark.scaling()) {
+                double bytesPerSecond = point.throughput * static_cast<double>(fixture->bytesPerCall()) / point.threads;
+                probeReport().bandwidth.push_back({streamKernelName(kernel), point.threads, bytesPerSecond, 0.0});
+            }
+        });
+    }
+}
+
+void registerPingPongProbes(const ProbeOptions& options) {
+    const std::vector<int> cpus = allowedCpus();
+    if (cpus.size() < 2) {
+        BenchmarkRegistry::instance().add("probe/pingpong", "probe", [] {
+            std::cout << "probe/pingpong: needs at least two CPUs in the affinity mask; skipped" << std::endl;
+        });
+        return;
+    }
+    for (std::size_t i = 0; i < cpus.size(); ++i) {
+        for (std::size_t j = i + 1; j < cpus.size(); ++j) {
+            const int a = cpus[i];
+            const int b = cpus[j];
+            std::string name = "probe/pingpong/" + std::to_string(a) + "-" + std::to_string(b);
+            BenchmarkRegistry::instance().add(name, "probe", [options, a, b, name] {
+                const int rounds = std::max(options.pingPongRounds, 1);
+                auto fixture = std::make_shared<PingPongFixture>(rounds);
+                MultiThreadedBenchmark benchmark(name, fixture, options.iterations, options.warmup, 2);
+                ExecutionPolicy policy;
+                policy.cpus = {a, b};
+                benchmark.setExecutionPolicy(policy);
+                benchmark.setResultFormat(ResultFormat::Csv, options.resultDirectory);
+                benchmark.run();
+                probeReport().pingPong.push_back({a, b, benchmark.stats().quantile(0.5) / (2.0 * rounds), 0.0});
+            });
+        }
+        if (!options.allPairs) break;
+    }
+}
+
+int kernelIndex(const std::string& kernel) {
+    int index = 0;
+    while (index < 4 && kernel != streamKernelName(static_cast<StreamKernel>(index))) ++index;
+    return index;
+}
+
+// Replaces the points sharing a key with one point holding the median value, ordered by key.
+template <typename Point, typename Key>
+void mergeRepeats(std::vector<Point>& points, Key key, double Point::*value) {
+    std::stable_sort(points.begin(), points.end(), [&](const Point& a, const Point& b) { return key(a) < key(b); });
+    std::vector<Point> merged;
+    for (std::size_t begin = 0; begin < points.size();) {
+        std::size_t end = begin;
+        int runs = 0;
+        std::vector<double> values;
+        while (end < points.size() && !(key(points[begin]) < key(points[end]))) {
+            values.push_back(points[end].*value);
+            runs += points[end].runs;
+            ++end;
+        }
+        std::sort(values.begin(), values.end());
+        const std::size_t middle = values.size() / 2;
+        Point point = points[begin];
+        point.*value = values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+        point.runs = runs;
+        merged.push_back(point);
+        begin = end;
+    }
+    points = std::move(merged);
+}
+
+} // namespace
+
+void ProbeReport::normalize(double peakGBs) {
+    mergeRepeats(latency, [](const LatencyPoint& point) { return point.bytes; }, &LatencyPoint::ns);
+    mergeRepeats(bandwidth, [](const BandwidthPoint& point) { return std::make_pair(kernelIndex(point.kernel), point.threads); },
+                 &BandwidthPoint::bytesPerSecond);
+    mergeRepeats(pingPong, [](const PingPongPoint& point) { return std::make_pair(point.cpuA, point.cpuB); },
+                 &PingPongPoint::ns);
+
+    tscGhz = isTscAvailable() ? 1.0 / timerCalibration(TimerKind::Tsc).nsPerTick : 0.0;
+    for (auto& point : latency) point.cycles = point.ns * tscGhz;
+    for (auto& point : pingPong) point.cycles = point.ns * tscGhz;
+
+    measuredPeak = peakGBs <= 0.0;
+    peakBytesPerSecond = peakGBs * 1e9;
+    if (measuredPeak) {
+        for (const auto& point : bandwidth) peakBytesPerSecond = std::max(peakBytesPerSecond, point.bytesPerSecond);
+    }
+    for (auto& point : bandwidth) {
+        point.ofPeak = peakBytesPerSecond > 0.0 ? point.bytesPerSecond / peakBytesPerSecond : 0.0;
+    }
+}
+
+void ProbeReport::print() const {
+    std::cout << "Probe Summary (TSC " << tscGhz << " GHz, peak " << peakBytesPerSecond / 1e9 << " GB/s"
+              << (measuredPeak ? " measured" : " configured") << ")" << std::endl;
+    if (!latency.empty()) {
+        std::cout << "Working Set,Latency (ns),Latency (cycles)" << std::endl;
+        for (const auto& point : latency) {
+            std::cout << formatBytes(point.bytes) << "," << point.ns << "," << point.cycles << std::endl;
+        }
+    }
+    if (!bandwidth.empty()) {
+        std::cout << "Kernel,Threads,Bandwidth (GB/s),Per Thread (GB/s),Of Peak (%)" << std::endl;
+        for (const auto& point : bandwidth) {
+            std::cout << point.kernel << "," << point.threads << "," << point.bytesPerSecond / 1e9 << ","
+                      << point.bytesPerSecond / 1e9 / point.threads << "," << point.ofPeak * 100.0 << std::endl;
+        }
+    }
+    if (!pingPong.empty()) {
+        std::cout << "CPU A,CPU B,One-Way (ns),One-Way (cycles)" << std::endl;
+        for (const auto& point : pingPong) {
+            std::cout << point.cpuA << "," << point.cpuB << "," << point.ns << "," << point.cycles << std::endl;
+        }
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+ResultTable ProbeReport::latencyTable() const {
+    ResultTable table;
+    table.name = "probe/summary/latency";
+    table.addMetadata("tsc_ghz", std::to_string(tscGhz));
+    auto& bytes = table.addIntColumn("Working Set (bytes)", latency.size());
+    for (const auto& point : latency) bytes.ints.push_back(static_cast<int64_t>(point.bytes));
+    auto& ns = table.addDoubleColumn("Latency (ns)", latency.size());
+    for (const auto& point : latency) ns.doubles.push_back(point.ns);
+    auto& cycles = table.addDoubleColumn("Latency (cycles)", latency.size());
+    for (const auto& point : latency) cycles.doubles.push_back(point.cycles);
+    auto& runs = table.addIntColumn("Runs", latency.size());
+    for (const auto& point : latency) runs.ints.push_back(point.runs);
+    return table;
+}
+
+ResultTable ProbeReport::bandwidthTable() const {
+    ResultTable table;
+    table.name = "probe/summary/bandwidth";
+    table.addMetadata("peak_bytes_per_second", std::to_string(peakBytesPerSecond));
+    table.addMetadata("peak_source", measuredPeak ? "measured" : "configured");
+    // Columns hold numbers only, so kernels are numbered in STREAM order.
+    table.addMetadata("kernels", "0=copy;1=scale;2=add;3=triad");
+    auto& kernel = table.addIntColumn("Kernel", bandwidth.size());
+    for (const auto& point : bandwidth) kernel.ints.push_back(kernelIndex(point.kernel));
+    auto& threads = table.addIntColumn("Threads", bandwidth.size());
+    for (const auto& point : bandwidth) threads.ints.push_back(point.threads);
+    auto& rate = table.addDoubleColumn("Bandwidth (bytes/s)", bandwidth.size());
+    for (const auto& point : bandwidth) rate.doubles.push_back(point.bytesPerSecond);
+    auto& ofPeak = table.addDoubleColumn("Of Peak", bandwidth.size());
+    for (const auto& point : bandwidth) ofPeak.doubles.push_back(point.ofPeak);
+    auto& runs = table.addIntColumn("Runs", bandwidth.size());
+    for (const auto& point : bandwidth) runs.ints.push_back(point.runs);
+    return table;
+}
+
+ResultTable ProbeReport::pingPongTable() const {
+    ResultTable table;
+    table.name = "probe/summary/pingpong";
+    table.addMetadata("tsc_ghz", std::to_string(tscGhz));
+    auto& cpuA = table.addIntColumn("CPU A", pingPong.size());
+    for (const auto& point : pingPong) cpuA.ints.push_back(point.cpuA);
+    auto& cpuB = table.addIntColumn("CPU B", pingPong.size());
+    for (const auto& point : pingPong) cpuB.ints.push_back(point.cpuB);
+    auto& ns = table.addDoubleColumn("One-Way (ns)", pingPong.size());
+    for (const auto& point : pingPong) ns.doubles.push_back(point.ns);
+    auto& cycles = table.addDoubleColumn("One-Way (cycles)", pingPong.size());
+    for (const auto& point : pingPong) cycles.doubles.push_back(point.cycles);
+    auto& runs = table.addIntColumn("Runs", pingPong.size());
+    for (const auto& point : pingPong) runs.ints.push_back(point.runs);
+    return table;
+}
+
+ProbeReport& probeReport() {
+    static ProbeReport report;
+    return report;
+}
+
+void registerProbeSuite(const ProbeOptions& options) {
+    registerLatencyProbes(options);
+    registerStreamProbes(options);
+    registerPingPongProbes(options);
+}
+
+void writeProbeSummary(const ProbeOptions& options) {
+    ProbeReport& report = probeReport();
+    if (report.latency.empty() && report.bandwidth.empty() && report.pingPong.empty()) return;
+    report.normalize(options.peakBandwidthGBs);
+    report.print();
+    CsvSink sink(options.resultDirectory);
+    for (const ResultTable& table : {report.latencyTable(), report.bandwidthTable(), report.pingPongTable()}) {
+        if (table.rows() == 0) continue;
+        if (sink.write(table)) {
+            std::cout << "Results exported to " << sink.path(table) << std::endl;
+        } else {
+            std::cerr << "Failed to export results: " << sink.error() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "result_sink.h"
+
+// Built-in host characterization: dependent-load latency across working-set sizes, STREAM
+// copy/scale/add/triad bandwidth per thread count, and core-to-core cache-line ping-pong. Each probe is
+// a registered benchmark ("probe/..."), so the runner's --filter, --repetitions and --shuffle apply; the
+// derived figures collect in probeReport(), and writeProbeSummary() turns them into the summary once
+// every selected probe has run.
+
+struct ProbeOptions {
+    std::size_t minWorkingSet = 4u << 10;
+    std::size_t maxWorkingSet = 256u << 20;
+    int hopsPerCall = 1024;           // dependent loads per timed call of the latency probe
+    std::size_t streamArrayBytes = 0; // per array; 0 means four times the last-level cache (at least 32 MiB)
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    double peakBandwidthGBs = 0.0;    // theoretical memory bandwidth; 0 normalizes to the best measured
+    int pingPongRounds = 1000;        // round trips per timed call
+    bool allPairs = false;            // every CPU pair instead of the first CPU against each other one
+    int iterations = 50;
+    int warmup = 5;
+    std::string resultDirectory = ".";
+};
+
+// Repetitions of a probe add one point each; normalize() merges points with the same key into their
+// median and records how many were merged in runs.
+struct LatencyPoint {
+    std::size_t bytes = 0;
+    double ns = 0.0;     // median per dependent load
+    double cycles = 0.0; // ns at the TSC frequency
+    int runs = 1;
+};
+
+struct BandwidthPoint {
+    std::string kernel;
+    int threads = 0;
+    double bytesPerSecond = 0.0;
+    double ofPeak = 0.0; // fraction of the peak used for normalization
+    int runs = 1;
+};
+
+struct PingPongPoint {
+    int cpuA = 0;
+    int cpuB = 0;
+    double ns = 0.0; // median one-way cache-line transfer
+    double cycles = 0.0;
+    int runs = 1;
+};
+
+struct ProbeReport {
+    double tscGhz = 0.0;
+    double peakBytesPerSecond = 0.0; // configured peak, or the best bandwidth measured
+    bool measuredPeak = true;
+    std::vector<LatencyPoint> latency;
+    std::vector<BandwidthPoint> bandwidth;
+    std::vector<PingPongPoint> pingPong;
+
+    // Merges repeated points and sorts them by key, then fills cycles and ofPeak; peakGBs of 0 takes
+    // the best measured bandwidth.
+    void normalize(double peakGBs);
+    void print() const;
+    ResultTable latencyTable() const;
+    ResultTable bandwidthTable() const;
+    ResultTable pingPongTable() const;
+};
+
+ProbeReport& probeReport();
+
+// Registers probe/latency/<size>, probe/stream/<kernel> and probe/pingpong/<cpu>-<cpu>.
+void registerProbeSuite(const ProbeOptions& options = {});
+// Normalizes probeReport(), prints it and exports probe/summary/{latency,bandwidth,pingpong} to
+// options.resultDirectory. Call once, after runRegisteredBenchmarks(); does nothing when no probe ran.
+void writeProbeSummary(const ProbeOptions& options = {});
+
+#endif // PROBES_H
@@ -0,0 +1,114 @@
+#include "registry.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <regex>
+
+BenchmarkRegistry& BenchmarkRegistry::instance() {
+    static BenchmarkRegistry registry;
+    return registry;
+}
+
+bool BenchmarkRegistry::add(std::string name, std::string kind, std::function<void()> run) {
+    entries_.push_back({std::move(name), std::move(kind), std::move(run)});
+    return true;
+}
+
+const std::vector<BenchmarkRegistry::Entry>& BenchmarkRegistry::entries() const {
+    return entries_;
+}
+
+bool parseRunnerOptions(int argc, char** argv, RunnerOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg](const std::string& prefix) { return arg.substr(prefix.size()); };
+        try {
+            if (arg.rfind("--filter=", 0) == 0) {
+                options.filter = value("--filter=");
+            } else if (arg.rfind("--repetitions=", 0) == 0) {
+                options.repetitions = std::stoi(value("--repetitions="));
+            } else if (arg == "--shuffle") {
+                options.shuffle = true;
+            } else if (arg.rfind("--shuffle=", 0) == 0) {
+                options.shuffle = true;
+                options.seed = std::stoull(value("--shuffle="));
+            } else if (arg == "--list") {
+                options.list = true;
+            } else {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value in argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.repetitions < 1) {
+        std::cerr << "--repetitions must be at least 1" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int runRegisteredBenchmarks(const RunnerOptions& options) {
+    // A cold-start child runs only the benchmark that spawned it, whatever the filter says.
+    if (const char* target = coldStartChildTarget()) {
+        for (const auto& entry : BenchmarkRegistry::instance().entries()) {
+            if (entry.name == target) {
+                entry.run();
+                break;
+            }
+        }
+        return 1;
+    }
+
+    std::regex filter;
+    try {
+        filter = std::regex(options.filter);
+    } catch (const std::regex_error& error) {
+        std::cerr << "Invalid --filter regex '" << options.filter << "': " << error.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<const BenchmarkRegistry::Entry*> selected;
+    for (const auto& entry : BenchmarkRegistry::instance().entries()) {
+        if (std::regex_search(entry.name, filter)) selected.push_back(&entry);
+    }
+
+    if (options.list) {
+        for (const auto* entry : selected) {
+            std::cout << entry->name << " [" << entry->kind << "]" << std::endl;
+        }
+        return 0;
+    }
+
+    std::vector<const BenchmarkRegistry::Entry*> schedule;
+    for (int r = 0; r < options.repetitions; ++r) {
+        schedule.insert(schedule.end(), selected.begin(), selected.end());
+    }
+    if (options.shuffle) {
+        uint64_t seed = options.seed ? options.seed : std::random_device()();
+        std::cout << "Shuffle seed: " << seed << std::endl;
+        std::mt19937_64 rng(seed);
+        std::shuffle(schedule.begin(), schedule.end(), rng);
+    }
+
+    for (const auto* entry : schedule) {
+        entry->run();
+    }
+    if (selected.empty()) {
+        std::cerr << "No benchmarks match filter '" << options.filter << "'" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int runRegisteredBenchmarks(int argc, char** argv) {
+    RunnerOptions options;
+    if (!parseRunnerOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--filter=REGEX] [--repetitions=N] [--shuffle[=SEED]] [--list]" << std::endl;
+        return 1;
+    }
+    return runRegisteredBenchmarks(options);
+}
@@ -0,0 +1,95 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "cold_start.h"
+
+class BenchmarkRegistry {
+public:
+    struct Entry {
+        std::string name;
+        std::string kind;
+        std::function<void()> run; // builds a fresh benchmark and runs it
+    };
+
+    static BenchmarkRegistry& instance();
+
+    bool add(std::string name, std::string kind, std::function<void()> run);
+    const std::vector<Entry>& entries() const;
+
+private:
+    std::vector<Entry> entries_;
+};
+
+struct RunnerOptions {
+    std::string filter = ".*"; // ECMAScript regex, matched anywhere in the name
+    int repetitions = 1;
+    bool shuffle = false;
+    uint64_t seed = 0; // 0 picks a random seed, which is printed so the order can be replayed
+    bool list = false;
+};
+
+// Parses --filter=REGEX, --repetitions=N, --shuffle[=SEED] and --list. Returns false on bad arguments.
+bool parseRunnerOptions(int argc, char** argv, RunnerOptions& options);
+int runRegisteredBenchmarks(const RunnerOptions& options);
+int runRegisteredBenchmarks(int argc, char** argv);
+
+template <typename T>
+void runBenchmarkObject(T& benchmark) {
+    benchmark.run();
+}
+
+template <typename T, typename Deleter>
+void runBenchmarkObject(std::unique_ptr<T, Deleter>& benchmark) {
+    benchmark->run();
+}
+
+template <typename T>
+void runBenchmarkObject(std::shared_ptr<T>& benchmark) {
+    benchmark->run();
+}
+
+// Registers a factory returning a Benchmark, MultiThreadedBenchmark, ColdStartBenchmark or BasicBenchmark
+// (by value or smart pointer).
+template <typename Factory>
+bool registerBenchmark(std::string name, std::string kind, Factory factory) {
+    return BenchmarkRegistry::instance().add(std::move(name), std::move(kind), [factory] {
+        auto benchmark = factory();
+        runBenchmarkObject(benchmark);
+    });
+}
+
+#define PINNACIUM_CONCAT_INNER(a, b) a##b
+#define PINNACIUM_CONCAT(a, b) PINNACIUM_CONCAT_INNER(a, b)
+
+#define PINNACIUM_REGISTER(name, kind, factory) \
+    static const bool PINNACIUM_CONCAT(pinnaciumRegistered_, __COUNTER__) = registerBenchmark(name, kind, factory)
+
+#define PINNACIUM_BENCHMARK(fn) \
+    PINNACIUM_REGISTER(#fn, "single", [] { return std::make_unique<Benchmark>(#fn, fn); })
+
+#define PINNACIUM_MULTITHREADED_BENCHMARK(fn, threads) \
+    PINNACIUM_REGISTER(#fn "_threads" #threads, "multithreaded", \
+                       [] { return std::make_unique<MultiThreadedBenchmark>(#fn "_threads" #threads, fn, 100, 10, threads); })
+
+// Each iteration in a fresh re-executed child; the registered name is what the child looks for.
+#define PINNACIUM_COLD_START_BENCHMARK(fn) \
+    PINNACIUM_REGISTER(#fn "_cold", "cold-start", [] { \
+        ColdStartOptions options; \
+        options.launch = ColdStartLaunch::Exec; \
+        return std::make_unique<ColdStartBenchmark>(#fn "_cold", fn, 20, options); \
+    })
+
+#define PINNACIUM_MAIN() \
+    int main(int argc, char** argv) { \
+        return runRegisteredBenchmarks(argc, argv); \
+    }
+
+#endif // REGISTRY_H
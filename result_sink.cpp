@@ -0,0 +1,651 @@
+#include "result_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kWriteBufferSize = 1 << 20;
+constexpr char kBinaryMagic[4] = {'P', 'I', 'N', 'B'};
+constexpr const char* kCsvNameKey = "benchmark";
+
+class BufferedWriter {
+public:
+    explicit BufferedWriter(std::FILE* file) : file_(file), buffer_(kWriteBufferSize) {}
+
+    ~BufferedWriter() {
+        flush();
+    }
+
+    void append(const char* data, std::size_t size) {
+        if (size > buffer_.size() - used_) {
+            flush();
+            if (size > buffer_.size()) {
+                ok_ = ok_ && std::fwrite(data, 1, size, file_) == size;
+                return;
+            }
+        }
+        std::memcpy(buffer_.data() + used_, data, size);
+        used_ += size;
+    }
+
+    void append(const std::string& text) {
+        append(text.data(), text.size());
+    }
+
+    void append(char c) {
+        if (used_ == buffer_.size()) flush();
+        buffer_[used_++] = c;
+    }
+
+    void appendInt(int64_t value) {
+        reserve(24);
+        auto result = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value);
+        used_ = static_cast<std::size_t>(result.ptr - buffer_.data());
+    }
+
+    void appendDouble(double value) {
+        reserve(32);
+        auto result = std::to_chars(buffer_.data() + used_, buffer_.data() + buffer_.size(), value);
+        used_ = static_cast<std::size_t>(result.ptr - buffer_.data());
+    }
+
+    bool flush() {
+        if (used_) {
+            ok_ = ok_ && std::fwrite(buffer_.data(), 1, used_, file_) == used_;
+            used_ = 0;
+        }
+        return ok_;
+    }
+
+private:
+    void reserve(std::size_t size) {
+        if (buffer_.size() - used_ < size) flush();
+    }
+
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    std::size_t used_ = 0;
+    bool ok_ = true;
+};
+
+void appendJsonString(BufferedWriter& writer, const std::string& text) {
+    writer.append('"');
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            writer.append("\\\"", 2);
+            break;
+        case '\\':
+            writer.append("\\\\", 2);
+            break;
+        case '\n':
+            writer.append("\\n", 2);
+            break;
+        case '\t':
+            writer.append("\\t", 2);
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                writer.append(escaped, 6);
+            } else {
+                writer.append(c);
+            }
+        }
+    }
+    writer.append('"');
+}
+
+void appendCsvField(BufferedWriter& writer, const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        writer.append(text);
+        return;
+    }
+    writer.append('"');
+    for (char c : text) {
+        if (c == '"') writer.append('"');
+        writer.append(c);
+    }
+    writer.append('"');
+}
+
+void appendValue(BufferedWriter& writer, const ResultColumn& column, std::size_t row) {
+    if (row >= column.size()) return;
+    if (column.type == ResultColumn::Type::Int64) {
+        writer.appendInt(column.ints[row]);
+    } else {
+        writer.appendDouble(column.doubles[row]);
+    }
+}
+
+std::size_t stringBytes(const std::string& text) {
+    return sizeof(uint32_t) + text.size();
+}
+
+template <typename T>
+void put(char*& out, T value) {
+    std::memcpy(out, &value, sizeof(T));
+    out += sizeof(T);
+}
+
+void putString(char*& out, const std::string& text) {
+    put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+    std::memcpy(out, text.data(), text.size());
+    out += text.size();
+}
+
+template <typename T>
+bool get(const char*& in, const char* end, T& value) {
+    if (static_cast<std::size_t>(end - in) < sizeof(T)) return false;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return true;
+}
+
+bool getString(const char*& in, const char* end, std::string& text) {
+    uint32_t size;
+    if (!get(in, end, size) || static_cast<std::size_t>(end - in) < size) return false;
+    text.assign(in, size);
+    in += size;
+    return true;
+}
+
+// Splits one CSV record, undoing the quoting applied by appendCsvField.
+std::vector<std::string> splitCsvRecord(const std::string& line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back() += '"';
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                fields.back() += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+bool parseInt(const std::string& text, int64_t& value) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return ec == std::errc() && ptr == end;
+}
+
+bool parseDouble(const std::string& text, double& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return end == text.c_str() + text.size();
+}
+
+std::string nameFromPath(const std::string& path) {
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    for (const char* suffix : {"_results.csv", ".csv"}) {
+        std::size_t length = std::strlen(suffix);
+        if (name.size() > length && name.compare(name.size() - length, length, suffix) == 0) {
+            return name.substr(0, name.size() - length);
+        }
+    }
+    return name;
+}
+
+std::vector<std::pair<std::string, std::string>>& contextStorage() {
+    static std::vector<std::pair<std::string, std::string>> context;
+    return context;
+}
+
+} // namespace
+
+std::string resultFileName(const std::string& name, const std::string& suffix) {
+    std::string file = name;
+    for (auto& c : file) {
+        if (c == '/' || c == '\\' || c == ':') c = '_';
+    }
+    return file + suffix;
+}
+
+ResultColumn& ResultTable::addIntColumn(std::string columnName, std::size_t reserve) {
+    columns.push_back(ResultColumn{std::move(columnName), ResultColumn::Type::Int64, {}, {}});
+    columns.back().ints.reserve(reserve);
+    return columns.back();
+}
+
+ResultColumn& ResultTable::addDoubleColumn(std::string columnName, std::size_t reserve) {
+    columns.push_back(ResultColumn{std::move(columnName), ResultColumn::Type::Double, {}, {}});
+    columns.back().doubles.reserve(reserve);
+    return columns.back();
+}
+
+void ResultTable::addMetadata(std::string key, std::string value) {
+    metadata.emplace_back(std::move(key), std::move(value));
+}
+
+std::size_t ResultTable::rows() const {
+    std::size_t rows = 0;
+    for (const auto& column : columns) {
+        rows = std::max(rows, column.size());
+    }
+    return rows;
+}
+
+void setResultContext(std::vector<std::pair<std::string, std::string>> context) {
+    contextStorage() = std::move(context);
+}
+
+const std::vector<std::pair<std::string, std::string>>& resultContext() {
+    return contextStorage();
+}
+
+std::vector<std::pair<std::string, std::string>> headerMetadata(const ResultTable& table) {
+    std::vector<std::pair<std::string, std::string>> header;
+    header.reserve(resultContext().size() + table.metadata.size());
+    for (const auto& entry : resultContext()) {
+        bool present = std::any_of(table.metadata.begin(), table.metadata.end(),
+                                   [&](const auto& own) { return own.first == entry.first; });
+        if (!present) header.push_back(entry);
+    }
+    header.insert(header.end(), table.metadata.begin(), table.metadata.end());
+    return header;
+}
+
+ResultSink::ResultSink(std::string directory) : directory_(std::move(directory)) {}
+
+std::string ResultSink::path(const ResultTable& table) const {
+    std::string file = resultFileName(table.name, std::string("_results") + extension());
+    if (directory_.empty() || directory_ == ".") return file;
+    return directory_ + (directory_.back() == '/' ? "" : "/") + file;
+}
+
+const std::string& ResultSink::error() const {
+    return error_;
+}
+
+bool writeCsv(const ResultTable& table, std::FILE* out) {
+    BufferedWriter writer(out);
+    if (!table.name.empty()) {
+        writer.append("# ", 2);
+        writer.append(kCsvNameKey);
+        writer.append(": ", 2);
+        writer.append(table.name);
+        writer.append('\n');
+    }
+    for (const auto& entry : headerMetadata(table)) {
+        writer.append("# ", 2);
+        writer.append(entry.first);
+        writer.append(": ", 2);
+        writer.append(entry.second);
+        writer.append('\n');
+    }
+    for (std::size_t c = 0; c < table.columns.size(); ++c) {
+        if (c) writer.append(',');
+        appendCsvField(writer, table.columns[c].name);
+    }
+    writer.append('\n');
+
+    std::size_t rows = table.rows();
+    for (std::size_t r = 0; r < rows; ++r) {
+        for (std::size_t c = 0; c < table.columns.size(); ++c) {
+            if (c) writer.append(',');
+            appendValue(writer, table.columns[c], r);
+        }
+        writer.append('\n');
+    }
+    return writer.flush();
+}
+
+bool CsvSink::write(const ResultTable& table) {
+    std::string file = path(table);
+    std::FILE* out = std::fopen(file.c_str(), "wb");
+    if (!out) {
+        error_ = file + ": " + std::strerror(errno);
+        return false;
+    }
+    bool ok = writeCsv(table, out);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) error_ = file + ": write failed";
+    return ok;
+}
+
+const char* CsvSink::extension() const {
+    return ".csv";
+}
+
+bool BinarySink::write(const ResultTable& table) {
+    std::string file = path(table);
+    std::size_t rows = table.rows();
+
+    std::size_t headerBytes = sizeof(kBinaryMagic) + sizeof(uint32_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    headerBytes += stringBytes(table.name);
+    const auto metadata = headerMetadata(table);
+    for (const auto& entry : metadata) {
+        headerBytes += stringBytes(entry.first) + stringBytes(entry.second);
+    }
+    for (const auto& column : table.columns) {
+        headerBytes += sizeof(uint8_t) + stringBytes(column.name);
+    }
+    std::size_t dataOffset = (headerBytes + 7) / 8 * 8;
+    std::size_t totalBytes = dataOffset + rows * sizeof(uint64_t) * table.columns.size();
+
+#ifdef __unix__
+    int fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error_ = file + ": " + std::strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(totalBytes)) != 0) {
+        error_ = file + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        error_ = file + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    char* base = static_cast<char*>(mapping);
+#else
+    std::vector<char> storage(totalBytes);
+    char* base = storage.data();
+#endif
+
+    char* out = base;
+    std::memcpy(out, kBinaryMagic, sizeof(kBinaryMagic));
+    out += sizeof(kBinaryMagic);
+    put<uint32_t>(out, kVersion);
+    put<uint64_t>(out, rows);
+    put<uint32_t>(out, static_cast<uint32_t>(table.columns.size()));
+    put<uint32_t>(out, static_cast<uint32_t>(metadata.size()));
+    putString(out, table.name);
+    for (const auto& entry : metadata) {
+        putString(out, entry.first);
+        putString(out, entry.second);
+    }
+    for (const auto& column : table.columns) {
+        put<uint8_t>(out, static_cast<uint8_t>(column.type));
+        putString(out, column.name);
+    }
+    std::memset(out, 0, dataOffset - headerBytes);
+
+    out = base + dataOffset;
+    for (const auto& column : table.columns) {
+        const void* data = column.type == ResultColumn::Type::Int64 ? static_cast<const void*>(column.ints.data())
+                                                                    : static_cast<const void*>(column.doubles.data());
+        std::size_t bytes = column.size() * sizeof(uint64_t);
+        if (bytes) std::memcpy(out, data, bytes);
+        std::memset(out + bytes, 0, rows * sizeof(uint64_t) - bytes);
+        out += rows * sizeof(uint64_t);
+    }
+
+#ifdef __unix__
+    bool ok = munmap(mapping, totalBytes) == 0;
+    ok = ::close(fd) == 0 && ok;
+#else
+    std::ofstream stream(file, std::ios::binary);
+    stream.write(storage.data(), static_cast<std::streamsize>(storage.size()));
+    bool ok = static_cast<bool>(stream);
+#endif
+    if (!ok) error_ = file + ": write failed";
+    return ok;
+}
+
+const char* BinarySink::extension() const {
+    return ".pinb";
+}
+
+bool JsonSink::write(const ResultTable& table) {
+    std::string file = path(table);
+    std::FILE* out = std::fopen(file.c_str(), "wb");
+    if (!out) {
+        error_ = file + ": " + std::strerror(errno);
+        return false;
+    }
+
+    bool ok;
+    {
+        BufferedWriter writer(out);
+        writer.append("{\"name\":", 8);
+        appendJsonString(writer, table.name);
+        writer.append(",\"metadata\":{", 13);
+        const auto metadata = headerMetadata(table);
+        for (std::size_t i = 0; i < metadata.size(); ++i) {
+            if (i) writer.append(',');
+            appendJsonString(writer, metadata[i].first);
+            writer.append(':');
+            appendJsonString(writer, metadata[i].second);
+        }
+        writer.append("},\"columns\":[", 13);
+        for (std::size_t c = 0; c < table.columns.size(); ++c) {
+            const auto& column = table.columns[c];
+            if (c) writer.append(',');
+            writer.append("\n{\"name\":", 9);
+            appendJsonString(writer, column.name);
+            writer.append(column.type == ResultColumn::Type::Int64 ? ",\"type\":\"int64\",\"values\":[" : ",\"type\":\"double\",\"values\":[");
+            for (std::size_t r = 0; r < column.size(); ++r) {
+                if (r) writer.append(',');
+                appendValue(writer, column, r);
+            }
+            writer.append("]}", 2);
+        }
+        writer.append("\n]}\n", 4);
+        ok = writer.flush();
+    }
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) error_ = file + ": write failed";
+    return ok;
+}
+
+const char* JsonSink::extension() const {
+    return ".json";
+}
+
+std::unique_ptr<ResultSink> makeResultSink(ResultFormat format, std::string directory) {
+    switch (format) {
+    case ResultFormat::Binary:
+        return std::make_unique<BinarySink>(std::move(directory));
+    case ResultFormat::Json:
+        return std::make_unique<JsonSink>(std::move(directory));
+    case ResultFormat::Csv:
+    default:
+        return std::make_unique<CsvSink>(std::move(directory));
+    }
+}
+
+bool readBinaryResults(const std::string& path, ResultTable& table, std::string& error) {
+    const char* begin = nullptr;
+    std::size_t size = 0;
+#ifdef __unix__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    void* mapping = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = path + ": cannot map file";
+        return false;
+    }
+    begin = static_cast<const char*>(mapping);
+#else
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<char> storage;
+    storage.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    begin = storage.data();
+    size = storage.size();
+#endif
+
+    const char* in = begin;
+    const char* end = begin + size;
+    bool ok = [&] {
+        if (size < sizeof(kBinaryMagic) || std::memcmp(in, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+            error = path + ": not a Pinnacium binary result file";
+            return false;
+        }
+        in += sizeof(kBinaryMagic);
+        uint32_t version, columns, metadata;
+        uint64_t rows;
+        if (!get(in, end, version) || !get(in, end, rows) || !get(in, end, columns) || !get(in, end, metadata)) {
+            error = path + ": truncated header";
+            return false;
+        }
+        if (version != BinarySink::kVersion) {
+            error = path + ": unsupported version " + std::to_string(version);
+            return false;
+        }
+        table = ResultTable();
+        if (!getString(in, end, table.name)) {
+            error = path + ": truncated header";
+            return false;
+        }
+        for (uint32_t i = 0; i < metadata; ++i) {
+            std::string key, value;
+            if (!getString(in, end, key) || !getString(in, end, value)) {
+                error = path + ": truncated metadata";
+                return false;
+            }
+            table.addMetadata(std::move(key), std::move(value));
+        }
+        for (uint32_t i = 0; i < columns; ++i) {
+            uint8_t type;
+            std::string name;
+            if (!get(in, end, type) || !getString(in, end, name) || type > 1) {
+                error = path + ": bad column descriptor";
+                return false;
+            }
+            if (type == 0) {
+                table.addIntColumn(std::move(name));
+            } else {
+                table.addDoubleColumn(std::move(name));
+            }
+        }
+        std::size_t dataOffset = (static_cast<std::size_t>(in - begin) + 7) / 8 * 8;
+        if (size < dataOffset || (size - dataOffset) / sizeof(uint64_t) / std::max<uint32_t>(columns, 1) < rows) {
+            error = path + ": truncated column data";
+            return false;
+        }
+        const char* data = begin + dataOffset;
+        for (auto& column : table.columns) {
+            if (column.type == ResultColumn::Type::Int64) {
+                column.ints.resize(rows);
+                std::memcpy(column.ints.data(), data, rows * sizeof(int64_t));
+            } else {
+                column.doubles.resize(rows);
+                std::memcpy(column.doubles.data(), data, rows * sizeof(double));
+            }
+            data += rows * sizeof(uint64_t);
+        }
+        return true;
+    }();
+
+#ifdef __unix__
+    munmap(const_cast<char*>(begin), size);
+#endif
+    return ok;
+}
+
+bool readCsvResults(const std::string& path, ResultTable& table, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    table = ResultTable();
+    std::string line;
+    std::vector<std::string> header;
+    std::vector<std::vector<std::string>> records;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (header.empty() && line.compare(0, 2, "# ") == 0) {
+            std::size_t colon = line.find(": ", 2);
+            if (colon == std::string::npos) continue;
+            std::string key = line.substr(2, colon - 2);
+            std::string value = line.substr(colon + 2);
+            if (key == kCsvNameKey) {
+                table.name = std::move(value);
+            } else {
+                table.addMetadata(std::move(key), std::move(value));
+            }
+        } else if (header.empty()) {
+            header = splitCsvRecord(line);
+        } else if (!line.empty()) {
+            records.push_back(splitCsvRecord(line));
+            if (records.back().size() != header.size()) {
+                error = path + ": line " + std::to_string(records.size() + 1) + " has " +
+                        std::to_string(records.back().size()) + " fields, expected " + std::to_string(header.size());
+                return false;
+            }
+        }
+    }
+    if (header.empty()) {
+        error = path + ": missing header";
+        return false;
+    }
+    if (table.name.empty()) table.name = nameFromPath(path);
+
+    for (std::size_t c = 0; c < header.size(); ++c) {
+        bool integral = true;
+        int64_t intValue;
+        for (const auto& record : records) {
+            if (!parseInt(record[c], intValue)) {
+                integral = false;
+                break;
+            }
+        }
+        ResultColumn& column = integral ? table.addIntColumn(header[c], records.size())
+                                        : table.addDoubleColumn(header[c], records.size());
+        for (const auto& record : records) {
+            double doubleValue;
+            if (integral) {
+                parseInt(record[c], intValue);
+                column.ints.push_back(intValue);
+            } else if (parseDouble(record[c], doubleValue)) {
+                column.doubles.push_back(doubleValue);
+            } else {
+                error = path + ": non-numeric value '" + record[c] + "' in column " + header[c];
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool readResults(const std::string& path, ResultTable& table, std::string& error) {
+    static const std::string binaryExtension = ".pinb";
+    if (path.size() >= binaryExtension.size() &&
+        path.compare(path.size() - binaryExtension.size(), binaryExtension.size(), binaryExtension) == 0) {
+        return readBinaryResults(path, table, error);
+    }
+    return readCsvResults(path, table, error);
+}
@@ -0,0 +1,115 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Result file name for a benchmark; path separators and ':' in the name become '_'.
+std::string resultFileName(const std::string& name, const std::string& suffix = "_results.csv");
+
+struct ResultColumn {
+    enum class Type : uint8_t {
+        Int64 = 0,
+        Double = 1,
+    };
+
+    std::string name;
+    Type type = Type::Int64;
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+
+    std::size_t size() const {
+        return type == Type::Int64 ? ints.size() : doubles.size();
+    }
+};
+
+struct ResultTable {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> metadata;
+    std::vector<ResultColumn> columns;
+
+    // The returned reference is only valid until the next column is added.
+    ResultColumn& addIntColumn(std::string columnName, std::size_t reserve = 0);
+    ResultColumn& addDoubleColumn(std::string columnName, std::size_t reserve = 0);
+    void addMetadata(std::string key, std::string value);
+    std::size_t rows() const;
+};
+
+// Process-wide context (machine, build and timer, see machine_info.h) that every sink writes into the
+// header of every table ahead of the table's own metadata. A key the table already carries is not
+// repeated, so rewriting a table that was read back keeps its original context.
+void setResultContext(std::vector<std::pair<std::string, std::string>> context);
+const std::vector<std::pair<std::string, std::string>>& resultContext();
+// The header entries a sink writes for table: the context, then table.metadata. Custom sinks should use it too.
+std::vector<std::pair<std::string, std::string>> headerMetadata(const ResultTable& table);
+
+enum class ResultFormat {
+    Csv,
+    Binary,
+    Json,
+};
+
+class ResultSink {
+public:
+    explicit ResultSink(std::string directory = ".");
+    virtual ~ResultSink() = default;
+
+    // Writes the table to path(table); returns false and sets error() on failure.
+    virtual bool write(const ResultTable& table) = 0;
+    virtual const char* extension() const = 0;
+
+    std::string path(const ResultTable& table) const;
+    const std::string& error() const;
+
+protected:
+    std::string directory_;
+    std::string error_;
+};
+
+// CSV through a large preallocated buffer with std::to_chars formatting.
+// The table name and metadata are emitted as leading "# benchmark: name" and "# key: value" lines.
+class CsvSink : public ResultSink {
+public:
+    using ResultSink::ResultSink;
+
+    bool write(const ResultTable& table) override;
+    const char* extension() const override;
+};
+
+// Columnar little-endian binary (".pinb"), written through a shared mapping of the output file:
+//   "PINB" u32 version, u64 rows, u32 columns, u32 metadata entries,
+//   u32-length-prefixed table name, metadata key/value strings, and per column a u8 type plus name;
+//   zero padding to 8 bytes, then each column's rows * 8 bytes back to back.
+class BinarySink : public ResultSink {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    using ResultSink::ResultSink;
+
+    bool write(const ResultTable& table) override;
+    const char* extension() const override;
+};
+
+class JsonSink : public ResultSink {
+public:
+    using ResultSink::ResultSink;
+
+    bool write(const ResultTable& table) override;
+    const char* extension() const override;
+};
+
+bool writeCsv(const ResultTable& table, std::FILE* out);
+std::unique_ptr<ResultSink> makeResultSink(ResultFormat format, std::string directory = ".");
+// Reads a file written by BinarySink; returns false and sets error on failure.
+bool readBinaryResults(const std::string& path, ResultTable& table, std::string& error);
+// Reads a file written by CsvSink. A column is Int64 when every value is an integer, Double otherwise;
+// files without a "# benchmark:" line are named after the file.
+bool readCsvResults(const std::string& path, ResultTable& table, std::string& error);
+// Dispatches on the extension: ".pinb" is binary, anything else is read as CSV.
+bool readResults(const std::string& path, ResultTable& table, std::string& error);
+
+#endif // RESULT_SINK_H
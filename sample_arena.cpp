@@ -0,0 +1,122 @@
+#include "sample_arena.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t kHugePage = 2u << 20;
+
+std::size_t roundUp(std::size_t bytes, std::size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+std::size_t pageSize() {
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<std::size_t>(size) : 4096;
+}
+
+} // namespace
+
+SampleArena::~SampleArena() {
+    release();
+}
+
+SampleArena::SampleArena(SampleArena&& other) noexcept {
+    *this = std::move(other);
+}
+
+SampleArena& SampleArena::operator=(SampleArena&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapped_ = std::exchange(other.mapped_, 0);
+        backing_ = std::exchange(other.backing_, Backing::None);
+        error_ = std::move(other.error_);
+    }
+    return *this;
+}
+
+bool SampleArena::reserve(std::size_t bytes) {
+    release();
+    if (bytes == 0) return true;
+
+    void* memory = MAP_FAILED;
+    // Small arenas would waste most of a huge page.
+    if (bytes >= kHugePage) {
+#ifdef MAP_HUGETLB
+        mapped_ = roundUp(bytes, kHugePage);
+        memory = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) backing_ = Backing::HugeTlb;
+#endif
+    }
+    if (memory == MAP_FAILED) {
+        mapped_ = roundUp(bytes, bytes >= kHugePage ? kHugePage : pageSize());
+        memory = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            error_ = std::string("mmap of sample arena failed: ") + std::strerror(errno);
+            mapped_ = 0;
+            return false;
+        }
+        backing_ = Backing::Normal;
+#ifdef MADV_HUGEPAGE
+        if (bytes >= kHugePage && madvise(memory, mapped_, MADV_HUGEPAGE) == 0) backing_ = Backing::Transparent;
+#endif
+    }
+    data_ = static_cast<char*>(memory);
+    size_ = bytes;
+    return true;
+}
+
+void SampleArena::prefault(std::size_t offset, std::size_t bytes) {
+    if (!data_ || offset >= size_) return;
+    bytes = std::min(bytes, size_ - offset);
+    const std::size_t step = pageSize();
+    volatile char* begin = data_ + offset;
+    for (std::size_t at = 0; at < bytes; at += step) begin[at] = 0;
+    if (bytes) begin[bytes - 1] = 0;
+}
+
+void SampleArena::release() {
+    if (data_) munmap(data_, mapped_);
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = 0;
+    backing_ = Backing::None;
+}
+
+char* SampleArena::data() const {
+    return data_;
+}
+
+std::size_t SampleArena::size() const {
+    return size_;
+}
+
+SampleArena::Backing SampleArena::backing() const {
+    return backing_;
+}
+
+const std::string& SampleArena::error() const {
+    return error_;
+}
+
+const char* arenaBackingName(SampleArena::Backing backing) {
+    switch (backing) {
+    case SampleArena::Backing::None:
+        return "none";
+    case SampleArena::Backing::HugeTlb:
+        return "hugetlb";
+    case SampleArena::Backing::Transparent:
+        return "transparent";
+    case SampleArena::Backing::Normal:
+        return "normal";
+    }
+    return "unknown";
+}
@@ -0,0 +1,48 @@
+#ifndef SAMPLE_ARENA_H
+#define SAMPLE_ARENA_H
+
+#include <cstddef>
+#include <string>
+
+// One anonymous mapping that holds a run's recording state. It is reserved before measuring and
+// prefaulted, so no allocation or page fault lands between timed iterations. Explicit huge pages are
+// used when the system has some reserved; otherwise transparent huge pages are requested with madvise.
+class SampleArena {
+public:
+    enum class Backing {
+        None,        // nothing reserved
+        HugeTlb,     // MAP_HUGETLB
+        Transparent, // madvise(MADV_HUGEPAGE) accepted
+        Normal,      // base pages
+    };
+
+    SampleArena() = default;
+    ~SampleArena();
+    SampleArena(SampleArena&& other) noexcept;
+    SampleArena& operator=(SampleArena&& other) noexcept;
+    SampleArena(const SampleArena&) = delete;
+    SampleArena& operator=(const SampleArena&) = delete;
+
+    // Replaces any previous mapping. Returns false and sets error() on failure.
+    bool reserve(std::size_t bytes);
+    // Writes every page of [offset, offset + bytes); call it from the thread that will record into the
+    // range so first-touch places the pages on that thread's NUMA node.
+    void prefault(std::size_t offset, std::size_t bytes);
+    void release();
+
+    char* data() const;
+    std::size_t size() const;
+    Backing backing() const;
+    const std::string& error() const;
+
+private:
+    char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t mapped_ = 0;
+    Backing backing_ = Backing::None;
+    std::string error_;
+};
+
+const char* arenaBackingName(SampleArena::Backing backing);
+
+#endif // SAMPLE_ARENA_H
@@ -0,0 +1,117 @@
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "alloc_tracker.h"
+
+struct Sample {
+    int threadIndex;
+    int iteration;
+    long long duration;
+};
+
+// Fixed-capacity sample storage owned by a single worker; no locking, no allocation while recording.
+// The buffer is a view over memory laid out by its owner (a SampleArena slice): samples, then the
+// counter values of each sample, then optionally its allocation counters, each cache-line aligned.
+class alignas(64) ThreadSampleBuffer {
+public:
+    static constexpr std::size_t kCacheLine = 64;
+
+    ThreadSampleBuffer() = default;
+
+    // Bytes attach() needs for capacity records.
+    static std::size_t bytesFor(std::size_t capacity, std::size_t counterCount, bool allocations) {
+        return align(capacity * sizeof(Sample)) + align(capacity * counterCount * sizeof(uint64_t)) +
+               (allocations ? align(capacity * sizeof(AllocationCounters)) : 0);
+    }
+
+    // memory must be 64-byte aligned, hold bytesFor() bytes and outlive the buffer. Starts empty.
+    void attach(char* memory, std::size_t capacity, std::size_t counterCount, bool allocations) {
+        samples_ = reinterpret_cast<Sample*>(memory);
+        memory += align(capacity * sizeof(Sample));
+        counters_ = reinterpret_cast<uint64_t*>(memory);
+        memory += align(capacity * counterCount * sizeof(uint64_t));
+        allocations_ = allocations ? reinterpret_cast<AllocationCounters*>(memory) : nullptr;
+        capacity_ = capacity;
+        counterCount_ = counterCount;
+        size_ = 0;
+    }
+
+    // Appends as many of other's records as fit; the counter layouts must match.
+    void copyFrom(const ThreadSampleBuffer& other) {
+        std::size_t count = other.size_ < capacity_ ? other.size_ : capacity_;
+        if (count == 0) return;
+        std::memcpy(samples_ + size_, other.samples_, count * sizeof(Sample));
+        if (counterCount_) std::memcpy(counterSlot(), other.counters_, count * counterCount_ * sizeof(uint64_t));
+        if (allocations_ && other.allocations_) std::memcpy(allocations_ + size_, other.allocations_, count * sizeof(AllocationCounters));
+        size_ += count;
+    }
+
+    // Counter values for the sample that the next record() call will store. The owner sizes the buffer
+    // for every sample it records, so a full buffer is a harness bug, not data to drop quietly.
+    uint64_t* counterSlot() {
+        assert(size_ < capacity_ && "ThreadSampleBuffer full: counter slot past the end of its slice");
+        return counters_ + size_ * counterCount_;
+    }
+
+    void record(int threadIndex, int iteration, long long duration, const AllocationCounters* allocations = nullptr) {
+        assert(size_ < capacity_ && "ThreadSampleBuffer full: sample would be dropped");
+        if (size_ < capacity_) {
+            new (samples_ + size_) Sample{threadIndex, iteration, duration};
+            if (allocations_) new (allocations_ + size_) AllocationCounters(allocations ? *allocations : AllocationCounters{});
+            ++size_;
+        }
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    std::size_t counterCount() const {
+        return counterCount_;
+    }
+
+    const uint64_t* counters(std::size_t index) const {
+        return counters_ + index * counterCount_;
+    }
+
+    // nullptr when the buffer was attached without allocation records.
+    const AllocationCounters* allocations(std::size_t index) const {
+        return allocations_ ? allocations_ + index : nullptr;
+    }
+
+    const Sample* begin() const {
+        return samples_;
+    }
+
+    const Sample* end() const {
+        return samples_ + size_;
+    }
+
+private:
+    static std::size_t align(std::size_t bytes) {
+        return (bytes + kCacheLine - 1) / kCacheLine * kCacheLine;
+    }
+
+    Sample* samples_ = nullptr;
+    uint64_t* counters_ = nullptr;
+    AllocationCounters* allocations_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t counterCount_ = 0;
+    std::size_t size_ = 0;
+};
+
+#endif // SAMPLE_BUFFER_H
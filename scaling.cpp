@@ -0,0 +1,102 @@
+#include "scaling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Linearized model: n / speedup - 1 = sigma (n - 1) + kappa n (n - 1).
+double linearized(const ScalingPoint& point) {
+    return static_cast<double>(point.threads) / point.speedup - 1.0;
+}
+
+void computeRms(ScalingFit& fit, const std::vector<ScalingPoint>& points) {
+    double sum = 0.0;
+    int count = 0;
+    for (const auto& point : points) {
+        if (point.speedup <= 0.0) continue;
+        double error = (predictedSpeedup(fit, point.threads) - point.speedup) / point.speedup;
+        sum += error * error;
+        ++count;
+    }
+    fit.rms = count ? std::sqrt(sum / count) : 0.0;
+}
+
+} // namespace
+
+std::vector<int> defaultThreadSweep(int maxThreads) {
+    maxThreads = std::max(maxThreads, 1);
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2) {
+        counts.push_back(n);
+    }
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+void computeScaling(std::vector<ScalingPoint>& points) {
+    if (points.empty()) return;
+    const ScalingPoint& base = *std::min_element(points.begin(), points.end(),
+        [](const ScalingPoint& a, const ScalingPoint& b) { return a.threads < b.threads; });
+    double baseThroughput = base.throughput;
+    int baseThreads = base.threads;
+
+    for (auto& point : points) {
+        point.speedup = baseThroughput > 0.0 ? point.throughput / baseThroughput * baseThreads : 0.0;
+        point.efficiency = point.threads > 0 ? point.speedup / point.threads : 0.0;
+        point.serialFraction = 0.0;
+        if (point.threads > 1 && point.speedup > 0.0) {
+            double n = static_cast<double>(point.threads);
+            point.serialFraction = (1.0 / point.speedup - 1.0 / n) / (1.0 - 1.0 / n);
+        }
+    }
+}
+
+ScalingFit fitAmdahl(const std::vector<ScalingPoint>& points) {
+    double xy = 0.0;
+    double xx = 0.0;
+    for (const auto& point : points) {
+        if (point.threads < 2 || point.speedup <= 0.0) continue;
+        double x = point.threads - 1.0;
+        xy += x * linearized(point);
+        xx += x * x;
+    }
+    ScalingFit fit;
+    fit.sigma = xx > 0.0 ? xy / xx : 0.0;
+    computeRms(fit, points);
+    return fit;
+}
+
+ScalingFit fitUsl(const std::vector<ScalingPoint>& points) {
+    double s11 = 0.0, s12 = 0.0, s22 = 0.0, s1y = 0.0, s2y = 0.0;
+    int usable = 0;
+    for (const auto& point : points) {
+        if (point.threads < 2 || point.speedup <= 0.0) continue;
+        double n = static_cast<double>(point.threads);
+        double x1 = n - 1.0;
+        double x2 = n * (n - 1.0);
+        double y = linearized(point);
+        s11 += x1 * x1;
+        s12 += x1 * x2;
+        s22 += x2 * x2;
+        s1y += x1 * y;
+        s2y += x2 * y;
+        ++usable;
+    }
+
+    double determinant = s11 * s22 - s12 * s12;
+    if (usable < 2 || std::fabs(determinant) <= 1e-12 * s11 * s22) {
+        return fitAmdahl(points);
+    }
+    ScalingFit fit;
+    fit.sigma = (s1y * s22 - s2y * s12) / determinant;
+    fit.kappa = (s2y * s11 - s1y * s12) / determinant;
+    computeRms(fit, points);
+    return fit;
+}
+
+double predictedSpeedup(const ScalingFit& fit, int threads) {
+    double n = static_cast<double>(threads);
+    double denominator = 1.0 + fit.sigma * (n - 1.0) + fit.kappa * n * (n - 1.0);
+    return denominator > 0.0 ? n / denominator : 0.0;
+}
@@ -0,0 +1,30 @@
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <vector>
+
+struct ScalingPoint {
+    int threads = 0;
+    double throughput = 0.0;     // operations per second across all threads
+    double speedup = 0.0;        // relative to the smallest thread count, assumed to scale linearly
+    double efficiency = 0.0;     // speedup / threads
+    double serialFraction = 0.0; // Karp-Flatt metric; 0 for a single thread
+};
+
+// Universal Scalability Law: speedup(n) = n / (1 + sigma (n - 1) + kappa n (n - 1)).
+// Amdahl's law is the kappa = 0 case.
+struct ScalingFit {
+    double sigma = 0.0; // contention (serial fraction)
+    double kappa = 0.0; // coherency
+    double rms = 0.0;   // root-mean-square error of the predicted speedup relative to the measured one
+};
+
+// 1, 2, 4, ... below maxThreads, then maxThreads itself.
+std::vector<int> defaultThreadSweep(int maxThreads);
+// Fills speedup, efficiency and serialFraction from throughput.
+void computeScaling(std::vector<ScalingPoint>& points);
+ScalingFit fitAmdahl(const std::vector<ScalingPoint>& points);
+ScalingFit fitUsl(const std::vector<ScalingPoint>& points);
+double predictedSpeedup(const ScalingFit& fit, int threads);
+
+#endif // SCALING_H
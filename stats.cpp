@@ -0,0 +1,449 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "thread_pool.h"
+
+void RunningStats::add(double value) {
+    if (count_ == 0) {
+        min_ = value;
+        max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    ++count_;
+    double delta = value - mean_;
+    mean_ += delta / static_cast<double>(count_);
+    m2_ += delta * (value - mean_);
+}
+
+void RunningStats::addAll(const long long* values, std::size_t count) {
+    merge(sampleMoments(values, count));
+}
+
+void RunningStats::merge(const SampleMoments& moments) {
+    if (moments.count == 0) return;
+    RunningStats other;
+    other.count_ = moments.count;
+    other.mean_ = moments.mean();
+    other.m2_ = moments.m2;
+    other.min_ = static_cast<double>(moments.min);
+    other.max_ = static_cast<double>(moments.max);
+    merge(other);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.count_ == 0) return;
+    if (count_ == 0) {
+        *this = other;
+        return;
+    }
+    double total = static_cast<double>(count_ + other.count_);
+    double delta = other.mean_ - mean_;
+    mean_ += delta * static_cast<double>(other.count_) / total;
+    m2_ += other.m2_ + delta * delta * static_cast<double>(count_) * static_cast<double>(other.count_) / total;
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+void RunningStats::clear() {
+    *this = RunningStats();
+}
+
+uint64_t RunningStats::count() const {
+    return count_;
+}
+
+double RunningStats::mean() const {
+    return mean_;
+}
+
+double RunningStats::variance() const {
+    return count_ > 0 ? m2_ / static_cast<double>(count_) : 0.0;
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+double RunningStats::min() const {
+    return min_;
+}
+
+double RunningStats::max() const {
+    return max_;
+}
+
+Histogram::Histogram(int precisionBits)
+    : precisionBits_(std::min(std::max(precisionBits, 1), 16)),
+      subBuckets_(static_cast<uint64_t>(1) << precisionBits_),
+      counts_(static_cast<std::size_t>(64 - precisionBits_ + 1) * subBuckets_, 0) {}
+
+void Histogram::record(uint64_t value, uint64_t count) {
+    if (count == 0) return;
+    counts_[bucketIndex(value)] += count;
+    if (total_ == 0) {
+        min_ = value;
+        max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    total_ += count;
+    sum_ += static_cast<double>(value) * static_cast<double>(count);
+}
+
+void Histogram::recordAll(const long long* values, std::size_t count) {
+    if (count == 0) return;
+    constexpr std::size_t kChunk = 1024;
+    uint32_t bins[kChunk];
+    for (std::size_t begin = 0; begin < count; begin += kChunk) {
+        const std::size_t chunk = std::min(kChunk, count - begin);
+        histogramBins(values + begin, chunk, precisionBits_, bins);
+        for (std::size_t i = 0; i < chunk; ++i) ++counts_[bins[i]];
+    }
+
+    SampleMoments range = sampleSumMinMax(values, count);
+    if (range.min < 0) {
+        // Negative values were recorded as zero, so they must not count towards the sum either.
+        range.sum = 0.0;
+        for (std::size_t i = 0; i < count; ++i) range.sum += static_cast<double>(std::max(values[i], 0LL));
+        range.min = 0;
+        range.max = std::max(range.max, 0LL);
+    }
+    const uint64_t low = static_cast<uint64_t>(range.min);
+    const uint64_t high = static_cast<uint64_t>(range.max);
+    min_ = total_ ? std::min(min_, low) : low;
+    max_ = total_ ? std::max(max_, high) : high;
+    total_ += count;
+    sum_ += range.sum;
+}
+
+void Histogram::merge(const Histogram& other) {
+    if (other.total_ == 0) return;
+    if (other.precisionBits_ != precisionBits_) {
+        for (std::size_t i = 0; i < other.counts_.size(); ++i) {
+            if (other.counts_[i]) record(other.bucketLow(i), other.counts_[i]);
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    min_ = total_ ? std::min(min_, other.min_) : other.min_;
+    max_ = total_ ? std::max(max_, other.max_) : other.max_;
+    total_ += other.total_;
+    sum_ += other.sum_;
+}
+
+void Histogram::clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    min_ = 0;
+    max_ = 0;
+    sum_ = 0.0;
+}
+
+uint64_t Histogram::count() const {
+    return total_;
+}
+
+uint64_t Histogram::min() const {
+    return min_;
+}
+
+uint64_t Histogram::max() const {
+    return max_;
+}
+
+double Histogram::mean() const {
+    return total_ ? sum_ / static_cast<double>(total_) : 0.0;
+}
+
+uint64_t Histogram::quantile(double q) const {
+    if (total_ == 0) return 0;
+    if (q <= 0.0) return min_;
+    if (q >= 1.0) return max_;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total_)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            uint64_t low = bucketLow(i);
+            uint64_t mid = low + (bucketHigh(i) - low) / 2;
+            return std::min(std::max(mid, min_), max_);
+        }
+    }
+    return max_;
+}
+
+double Histogram::sum() const {
+    return sum_;
+}
+
+void Histogram::restore(const std::vector<std::pair<std::size_t, uint64_t>>& buckets, uint64_t min, uint64_t max, double sum) {
+    clear();
+    for (const auto& [index, count] : buckets) {
+        if (index >= counts_.size()) continue;
+        counts_[index] += count;
+        total_ += count;
+    }
+    if (total_ == 0) return;
+    min_ = min;
+    max_ = max;
+    sum_ = sum;
+}
+
+int Histogram::precisionBits() const {
+    return precisionBits_;
+}
+
+std::size_t Histogram::bucketCount() const {
+    return counts_.size();
+}
+
+std::size_t Histogram::bucketIndex(uint64_t value) const {
+    if (value < subBuckets_) return static_cast<std::size_t>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - precisionBits_;
+    return static_cast<std::size_t>(static_cast<uint64_t>(shift + 1) * subBuckets_ + ((value >> shift) - subBuckets_));
+}
+
+uint64_t Histogram::bucketLow(std::size_t index) const {
+    if (index < 2 * subBuckets_) return index;
+    uint64_t block = index / subBuckets_;
+    uint64_t offset = index % subBuckets_;
+    return (subBuckets_ + offset) << (block - 1);
+}
+
+// Inclusive upper bound of the bucket.
+uint64_t Histogram::bucketHigh(std::size_t index) const {
+    if (index < 2 * subBuckets_) return index;
+    uint64_t block = index / subBuckets_;
+    uint64_t width = static_cast<uint64_t>(1) << (block - 1);
+    uint64_t low = bucketLow(index);
+    return low > std::numeric_limits<uint64_t>::max() - width ? std::numeric_limits<uint64_t>::max() : low + width - 1;
+}
+
+uint64_t Histogram::countAt(std::size_t index) const {
+    return counts_[index];
+}
+
+double exactQuantile(const std::vector<long long>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    q = std::min(std::max(q, 0.0), 1.0);
+    double position = q * static_cast<double>(sorted.size() - 1);
+    std::size_t lower = static_cast<std::size_t>(position);
+    std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+    double fraction = position - static_cast<double>(lower);
+    return static_cast<double>(sorted[lower]) + fraction * static_cast<double>(sorted[upper] - sorted[lower]);
+}
+
+OutlierSummary classifyOutliers(const std::vector<long long>& sorted) {
+    OutlierSummary outliers;
+    if (sorted.size() < 4) return outliers;
+
+    double q1 = exactQuantile(sorted, 0.25);
+    double q3 = exactQuantile(sorted, 0.75);
+    double iqr = q3 - q1;
+    outliers.lowerFence = q1 - 1.5 * iqr;
+    outliers.upperFence = q3 + 1.5 * iqr;
+    double lowerSevere = q1 - 3.0 * iqr;
+    double upperSevere = q3 + 3.0 * iqr;
+
+    double median = exactQuantile(sorted, 0.5);
+    std::vector<double> deviations;
+    deviations.reserve(sorted.size());
+    for (long long value : sorted) {
+        deviations.push_back(std::fabs(static_cast<double>(value) - median));
+    }
+    std::nth_element(deviations.begin(), deviations.begin() + deviations.size() / 2, deviations.end());
+    double madLimit = 3.0 * 1.4826 * deviations[deviations.size() / 2];
+
+    for (long long sample : sorted) {
+        double value = static_cast<double>(sample);
+        if (value < lowerSevere) {
+            ++outliers.lowSevere;
+        } else if (value < outliers.lowerFence) {
+            ++outliers.lowMild;
+        } else if (value > upperSevere) {
+            ++outliers.highSevere;
+        } else if (value > outliers.upperFence) {
+            ++outliers.highMild;
+        }
+        if (madLimit > 0.0) {
+            if (value < median - madLimit) ++outliers.madLow;
+            if (value > median + madLimit) ++outliers.madHigh;
+        }
+    }
+    return outliers;
+}
+
+ConfidenceInterval bootstrapMedianCI(const std::vector<long long>& samples, double confidence, int resamples, uint64_t seed,
+                                     Executor* executor) {
+    ConfidenceInterval interval;
+    if (samples.empty()) return interval;
+
+    std::vector<long long> scratch(samples);
+    std::nth_element(scratch.begin(), scratch.begin() + scratch.size() / 2, scratch.end());
+    interval.estimate = static_cast<double>(scratch[scratch.size() / 2]);
+    if (samples.size() < 2 || resamples < 2) {
+        interval.lower = interval.upper = interval.estimate;
+        return interval;
+    }
+
+    // Resample r always draws from stream r, so the split across workers does not change the result.
+    std::vector<double> medians(static_cast<std::size_t>(resamples));
+    const int workers = executor ? std::max(executor->size(), 1) : 1;
+    auto task = [&](int worker) {
+        std::vector<long long> buffer(samples.size());
+        for (int r = worker; r < resamples; r += workers) {
+            ResampleStream stream(seed, static_cast<uint64_t>(r));
+            resample(samples.data(), samples.size(), stream, buffer.data(), buffer.size());
+            std::nth_element(buffer.begin(), buffer.begin() + buffer.size() / 2, buffer.end());
+            medians[r] = static_cast<double>(buffer[buffer.size() / 2]);
+        }
+    };
+    if (executor) {
+        executor->run(task, workers);
+    } else {
+        task(0);
+    }
+    std::sort(medians.begin(), medians.end());
+
+    double alpha = (1.0 - confidence) / 2.0;
+    auto at = [&medians](double q) {
+        std::size_t index = static_cast<std::size_t>(q * static_cast<double>(medians.size() - 1) + 0.5);
+        return medians[std::min(index, medians.size() - 1)];
+    };
+    interval.lower = at(alpha);
+    interval.upper = at(1.0 - alpha);
+    return interval;
+}
+
+SampleStats::SampleStats(bool keepSamples, int precisionBits)
+    : keepSamples_(keepSamples), histogram_(precisionBits) {}
+
+void SampleStats::add(long long value) {
+    if (keepSamples_) {
+        samples_.push_back(value);
+        return;
+    }
+    running_.add(static_cast<double>(value));
+    histogram_.record(value > 0 ? static_cast<uint64_t>(value) : 0);
+}
+
+void SampleStats::addAll(const long long* values, std::size_t count) {
+    if (keepSamples_) {
+        samples_.insert(samples_.end(), values, values + count);
+        return;
+    }
+    running_.addAll(values, count);
+    histogram_.recordAll(values, count);
+}
+
+void SampleStats::merge(const SampleStats& other) {
+    fold();
+    other.fold();
+    running_.merge(other.running_);
+    histogram_.merge(other.histogram_);
+    if (keepSamples_ && other.keepSamples_) {
+        samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+    }
+    folded_ = samples_.size();
+}
+
+void SampleStats::reserve(std::size_t count) {
+    if (keepSamples_) samples_.reserve(count);
+}
+
+void SampleStats::clear() {
+    running_.clear();
+    histogram_.clear();
+    samples_.clear();
+    folded_ = 0;
+}
+
+void SampleStats::keepSamples(bool keep) {
+    if (!keep) {
+        fold();
+        samples_.clear();
+        samples_.shrink_to_fit();
+        folded_ = 0;
+    }
+    keepSamples_ = keep;
+}
+
+bool SampleStats::keepsSamples() const {
+    return keepSamples_;
+}
+
+uint64_t SampleStats::count() const {
+    fold();
+    return running_.count();
+}
+
+const RunningStats& SampleStats::running() const {
+    fold();
+    return running_;
+}
+
+const Histogram& SampleStats::histogram() const {
+    fold();
+    return histogram_;
+}
+
+const std::vector<long long>& SampleStats::samples() const {
+    return samples_;
+}
+
+void SampleStats::fold() const {
+    if (folded_ == samples_.size()) return;
+    const long long* pending = samples_.data() + folded_;
+    const std::size_t count = samples_.size() - folded_;
+    running_.addAll(pending, count);
+    histogram_.recordAll(pending, count);
+    folded_ = samples_.size();
+}
+
+double SampleStats::quantile(double q) const {
+    if (keepSamples_ && !samples_.empty()) {
+        std::vector<long long> sorted(samples_);
+        std::sort(sorted.begin(), sorted.end());
+        return exactQuantile(sorted, q);
+    }
+    return static_cast<double>(histogram_.quantile(q));
+}
+
+StatsSummary SampleStats::summarize() const {
+    fold();
+    StatsSummary summary;
+    summary.count = running_.count();
+    summary.mean = running_.mean();
+    summary.stddev = running_.stddev();
+    summary.min = running_.min();
+    summary.max = running_.max();
+
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999, 0.9999};
+    double* targets[] = {&summary.p50, &summary.p90, &summary.p99, &summary.p999, &summary.p9999};
+    if (keepSamples_ && !samples_.empty()) {
+        std::vector<long long> sorted(samples_);
+        std::sort(sorted.begin(), sorted.end());
+        for (int i = 0; i < 5; ++i) {
+            *targets[i] = exactQuantile(sorted, quantiles[i]);
+        }
+        summary.exactQuantiles = true;
+        summary.outliers = classifyOutliers(sorted);
+    } else {
+        for (int i = 0; i < 5; ++i) {
+            *targets[i] = static_cast<double>(histogram_.quantile(quantiles[i]));
+        }
+    }
+    return summary;
+}
@@ -0,0 +1,167 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "stats_kernels.h"
+
+class Executor;
+
+// Welford online mean/variance; merge() combines partial results (Chan et al.).
+class RunningStats {
+public:
+    void add(double value);
+    // Folds a block in with the vectorized two-pass kernel instead of one Welford step per value.
+    void addAll(const long long* values, std::size_t count);
+    void merge(const RunningStats& other);
+    void merge(const SampleMoments& moments);
+    void clear();
+
+    uint64_t count() const;
+    double mean() const;
+    double variance() const;
+    double stddev() const;
+    double min() const;
+    double max() const;
+
+private:
+    uint64_t count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+// Log-linear (HDR-style) histogram: each power-of-two range is split into 2^precisionBits
+// equal buckets, so the relative bucket width is at most 2^-precisionBits and memory is fixed.
+class Histogram {
+public:
+    explicit Histogram(int precisionBits = 7);
+
+    void record(uint64_t value, uint64_t count = 1);
+    // Records max(value, 0) for every value, binning them with the vectorized kernel.
+    void recordAll(const long long* values, std::size_t count);
+    void merge(const Histogram& other);
+    void clear();
+
+    uint64_t count() const;
+    uint64_t min() const;
+    uint64_t max() const;
+    double mean() const;
+    // Representative value of the bucket holding rank ceil(q * count), clamped to [min, max].
+    uint64_t quantile(double q) const;
+
+    double sum() const;
+    // Replaces the contents with non-empty buckets (index, count) and exact min/max/sum recorded by a
+    // histogram of the same precision elsewhere, e.g. in another process.
+    void restore(const std::vector<std::pair<std::size_t, uint64_t>>& buckets, uint64_t min, uint64_t max, double sum);
+
+    int precisionBits() const;
+    std::size_t bucketCount() const;
+    std::size_t bucketIndex(uint64_t value) const;
+    uint64_t bucketLow(std::size_t index) const;
+    uint64_t bucketHigh(std::size_t index) const;
+    uint64_t countAt(std::size_t index) const;
+
+private:
+    int precisionBits_;
+    uint64_t subBuckets_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+    double sum_ = 0.0;
+};
+
+struct OutlierSummary {
+    // Tukey fences: mild beyond 1.5 IQR, severe beyond 3 IQR from the quartiles.
+    std::size_t lowMild = 0;
+    std::size_t lowSevere = 0;
+    std::size_t highMild = 0;
+    std::size_t highSevere = 0;
+    // Beyond 3 scaled MADs (1.4826 * MAD) from the median.
+    std::size_t madLow = 0;
+    std::size_t madHigh = 0;
+    double lowerFence = 0.0;
+    double upperFence = 0.0;
+
+    std::size_t low() const {
+        return lowMild + lowSevere;
+    }
+
+    std::size_t high() const {
+        return highMild + highSevere;
+    }
+};
+
+struct ConfidenceInterval {
+    double estimate = 0.0;
+    double lower = 0.0;
+    double upper = 0.0;
+
+    double relativeWidth() const {
+        return estimate != 0.0 ? (upper - lower) / estimate : 0.0;
+    }
+};
+
+struct StatsSummary {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double p9999 = 0.0;
+    bool exactQuantiles = false;
+    OutlierSummary outliers; // only filled when exactQuantiles is set
+};
+
+// Linear interpolation between closest ranks; sorted must be ascending and non-empty.
+double exactQuantile(const std::vector<long long>& sorted, double q);
+OutlierSummary classifyOutliers(const std::vector<long long>& sorted);
+// Percentile bootstrap of the median; deterministic for a given seed whatever the executor. With an
+// executor the resamples are split across all of its workers, which must be idle.
+ConfidenceInterval bootstrapMedianCI(const std::vector<long long>& samples, double confidence = 0.95,
+                                     int resamples = 1000, uint64_t seed = 0x5eed, Executor* executor = nullptr);
+
+// Streams every sample into RunningStats and a Histogram; raw samples are kept only when asked,
+// in which case quantiles are exact, otherwise they come from the histogram. Kept samples are only
+// appended by add() and folded into the running stats and histogram in bulk on the next read.
+class SampleStats {
+public:
+    explicit SampleStats(bool keepSamples = true, int precisionBits = 7);
+
+    void add(long long value);
+    void addAll(const long long* values, std::size_t count);
+    // Raw samples are appended only when both sides keep them.
+    void merge(const SampleStats& other);
+    void reserve(std::size_t count);
+    void clear();
+    void keepSamples(bool keep);
+
+    bool keepsSamples() const;
+    uint64_t count() const;
+    const RunningStats& running() const;
+    const Histogram& histogram() const;
+    const std::vector<long long>& samples() const;
+
+    double quantile(double q) const;
+    StatsSummary summarize() const;
+
+private:
+    void fold() const;
+
+    bool keepSamples_;
+    mutable RunningStats running_;
+    mutable Histogram histogram_;
+    std::vector<long long> samples_;
+    mutable std::size_t folded_ = 0; // samples_[folded_, size) are not in running_ and histogram_ yet
+};
+
+#endif // STATS_H
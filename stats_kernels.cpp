@@ -0,0 +1,468 @@
+#include "stats_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PINNACIUM_STATS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Integers below this magnitude convert to double exactly through the 1.5 * 2^52 bias trick.
+constexpr long long kExactLimit = 1LL << 51;
+// Block sums of at most this many values below kExactLimit cannot overflow int64.
+constexpr std::size_t kSumBlock = 2048;
+constexpr uint64_t kNarrowSource = 1ULL << 32;
+
+SimdLevel detectLevel() {
+#ifdef PINNACIUM_STATS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+std::atomic<SimdLevel>& activeLevel() {
+    static std::atomic<SimdLevel> level{detectedSimdLevel()};
+    return level;
+}
+
+// Merges one block's integer sum, or falls back to summing doubles when it could have overflowed.
+void addBlock(SampleMoments& moments, const long long* values, std::size_t count, long long blockSum, long long blockMin,
+              long long blockMax) {
+    if (moments.count == 0) {
+        moments.min = blockMin;
+        moments.max = blockMax;
+    } else {
+        moments.min = std::min(moments.min, blockMin);
+        moments.max = std::max(moments.max, blockMax);
+    }
+    if (blockMin > -kExactLimit && blockMax < kExactLimit) {
+        moments.sum += static_cast<double>(blockSum);
+    } else {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < count; ++i) sum += static_cast<double>(values[i]);
+        moments.sum += sum;
+    }
+    moments.count += count;
+}
+
+void sumMinMaxBlockScalar(SampleMoments& moments, const long long* values, std::size_t count) {
+    // Wrapping unsigned adds; the result only counts when no value reaches kExactLimit.
+    uint64_t sum = 0;
+    long long low = values[0];
+    long long high = values[0];
+    for (std::size_t i = 0; i < count; ++i) {
+        sum += static_cast<uint64_t>(values[i]);
+        low = std::min(low, values[i]);
+        high = std::max(high, values[i]);
+    }
+    addBlock(moments, values, count, static_cast<long long>(sum), low, high);
+}
+
+double squaredDeviationsScalar(const long long* values, std::size_t count, double mean) {
+    double m2 = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        double delta = static_cast<double>(values[i]) - mean;
+        m2 += delta * delta;
+    }
+    return m2;
+}
+
+uint32_t binScalar(long long value, int precisionBits) {
+    const uint64_t subBuckets = static_cast<uint64_t>(1) << precisionBits;
+    const uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+    if (v < subBuckets) return static_cast<uint32_t>(v);
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - precisionBits;
+    return static_cast<uint32_t>(static_cast<uint64_t>(shift + 1) * subBuckets + ((v >> shift) - subBuckets));
+}
+
+void binsScalar(const long long* values, std::size_t count, int precisionBits, uint32_t* bins) {
+    for (std::size_t i = 0; i < count; ++i) bins[i] = binScalar(values[i], precisionBits);
+}
+
+uint64_t splitMix(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// One xorshift128+ step per lane; lanes are stepped together, so each step yields kLanes values.
+void stepScalar(ResampleStream& stream, uint64_t* out) {
+    for (int lane = 0; lane < ResampleStream::kLanes; ++lane) {
+        uint64_t x = stream.s0[lane];
+        const uint64_t y = stream.s1[lane];
+        stream.s0[lane] = y;
+        x ^= x << 23;
+        stream.s1[lane] = x ^ y ^ (x >> 17) ^ (y >> 26);
+        out[lane] = stream.s1[lane] + y;
+    }
+}
+
+// Multiply-shift range reduction (Lemire); narrow sources use the top 32 random bits so vector
+// lanes can do the same with a 32x32-bit multiply.
+std::size_t reduce(uint64_t random, uint64_t sourceCount) {
+    if (sourceCount < kNarrowSource) return static_cast<std::size_t>(((random >> 32) * sourceCount) >> 32);
+    return static_cast<std::size_t>((static_cast<unsigned __int128>(random) * sourceCount) >> 64);
+}
+
+template <typename T>
+void resampleScalar(const T* source, std::size_t sourceCount, ResampleStream& stream, T* out, std::size_t count) {
+    uint64_t random[ResampleStream::kLanes];
+    for (std::size_t i = 0; i < count; i += ResampleStream::kLanes) {
+        stepScalar(stream, random);
+        const std::size_t lanes = std::min<std::size_t>(ResampleStream::kLanes, count - i);
+        for (std::size_t lane = 0; lane < lanes; ++lane) out[i + lane] = source[reduce(random[lane], sourceCount)];
+    }
+}
+
+#ifdef PINNACIUM_STATS_X86
+
+__attribute__((target("avx2"))) inline __m256i toDoubleBiasAvx2() {
+    return _mm256_castpd_si256(_mm256_set1_pd(6755399441055744.0)); // 1.5 * 2^52
+}
+
+// Exact for |value| < kExactLimit.
+__attribute__((target("avx2"))) inline __m256d toDoubleAvx2(__m256i values) {
+    const __m256d bias = _mm256_set1_pd(6755399441055744.0);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(values, toDoubleBiasAvx2())), bias);
+}
+
+__attribute__((target("avx2"))) void sumMinMaxBlockAvx2(SampleMoments& moments, const long long* values, std::size_t count) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i low = _mm256_set1_epi64x(values[0]);
+    __m256i high = low;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        sum = _mm256_add_epi64(sum, v);
+        low = _mm256_blendv_epi8(low, v, _mm256_cmpgt_epi64(low, v));
+        high = _mm256_blendv_epi8(high, v, _mm256_cmpgt_epi64(v, high));
+    }
+    alignas(32) long long sums[4], lows[4], highs[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lows), low);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(highs), high);
+    uint64_t total = 0;
+    long long blockMin = lows[0];
+    long long blockMax = highs[0];
+    for (int lane = 0; lane < 4; ++lane) {
+        total += static_cast<uint64_t>(sums[lane]);
+        blockMin = std::min(blockMin, lows[lane]);
+        blockMax = std::max(blockMax, highs[lane]);
+    }
+    for (; i < count; ++i) {
+        total += static_cast<uint64_t>(values[i]);
+        blockMin = std::min(blockMin, values[i]);
+        blockMax = std::max(blockMax, values[i]);
+    }
+    addBlock(moments, values, count, static_cast<long long>(total), blockMin, blockMax);
+}
+
+__attribute__((target("avx2"))) double squaredDeviationsAvx2(const long long* values, std::size_t count, double mean) {
+    const __m256d center = _mm256_set1_pd(mean);
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d d0 = _mm256_sub_pd(toDoubleAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i))), center);
+        __m256d d1 = _mm256_sub_pd(toDoubleAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4))), center);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(d0, d0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(d1, d1));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(acc0, acc1));
+    return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]) + squaredDeviationsScalar(values + i, count - i, mean);
+}
+
+__attribute__((target("avx2"))) void binsAvx2(const long long* values, std::size_t count, int precisionBits, uint32_t* bins) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i subBuckets = _mm256_set1_epi64x(1LL << precisionBits);
+    const __m256i tooLarge = _mm256_set1_epi64x(kExactLimit - 1);
+    const __m256i exponentBias = _mm256_set1_epi64x(1023 + precisionBits);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m128i bitsCount = _mm_cvtsi32_si128(precisionBits);
+    const __m256i evenLanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        v = _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, v), v);
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi64(v, tooLarge))) {
+            binsScalar(values + i, 4, precisionBits, bins + i);
+            continue;
+        }
+        // The exponent of the exactly converted value is its most significant bit.
+        __m256i exponent = _mm256_srli_epi64(_mm256_castpd_si256(toDoubleAvx2(v)), 52);
+        __m256i shift = _mm256_sub_epi64(exponent, exponentBias);
+        __m256i large = _mm256_add_epi64(_mm256_sll_epi64(_mm256_add_epi64(shift, one), bitsCount),
+                                         _mm256_sub_epi64(_mm256_srlv_epi64(v, shift), subBuckets));
+        __m256i index = _mm256_blendv_epi8(large, v, _mm256_cmpgt_epi64(subBuckets, v));
+        __m256i packed = _mm256_permutevar8x32_epi32(index, evenLanes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bins + i), _mm256_castsi256_si128(packed));
+    }
+    binsScalar(values + i, count - i, precisionBits, bins + i);
+}
+
+__attribute__((target("avx2"))) inline __m256i stepAvx2(__m256i& s0, __m256i& s1) {
+    __m256i x = s0;
+    const __m256i y = s1;
+    s0 = y;
+    x = _mm256_xor_si256(x, _mm256_slli_epi64(x, 23));
+    s1 = _mm256_xor_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(_mm256_srli_epi64(x, 17), _mm256_srli_epi64(y, 26)));
+    return _mm256_add_epi64(s1, y);
+}
+
+__attribute__((target("avx2"))) inline __m256i reduceAvx2(__m256i random, __m256i sourceCount) {
+    return _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(random, 32), sourceCount), 32);
+}
+
+// Resamples 64-bit words; T is long long or double, gathered bit for bit.
+template <typename T>
+__attribute__((target("avx2"))) void resampleAvx2(const T* source, std::size_t sourceCount, ResampleStream& stream, T* out,
+                                                  std::size_t count) {
+    const long long* words = reinterpret_cast<const long long*>(source);
+    const __m256i range = _mm256_set1_epi64x(static_cast<long long>(sourceCount));
+    __m256i s0Low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream.s0));
+    __m256i s0High = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream.s0 + 4));
+    __m256i s1Low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream.s1));
+    __m256i s1High = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream.s1 + 4));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i low = _mm256_i64gather_epi64(words, reduceAvx2(stepAvx2(s0Low, s1Low), range), 8);
+        __m256i high = _mm256_i64gather_epi64(words, reduceAvx2(stepAvx2(s0High, s1High), range), 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 4), high);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(stream.s0), s0Low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(stream.s0 + 4), s0High);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(stream.s1), s1Low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(stream.s1 + 4), s1High);
+    resampleScalar(source, sourceCount, stream, out + i, count - i);
+}
+
+// GCC 12 reports its own _mm512_undefined_* placeholders inside the AVX-512 intrinsics as uninitialized.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+__attribute__((target("avx512f"))) void sumMinMaxBlockAvx512(SampleMoments& moments, const long long* values, std::size_t count) {
+    __m512i sum = _mm512_setzero_si512();
+    __m512i low = _mm512_set1_epi64(values[0]);
+    __m512i high = low;
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i v = _mm512_loadu_si512(values + i);
+        sum = _mm512_add_epi64(sum, v);
+        low = _mm512_mask_blend_epi64(_mm512_cmpgt_epi64_mask(low, v), low, v);
+        high = _mm512_mask_blend_epi64(_mm512_cmpgt_epi64_mask(v, high), high, v);
+    }
+    uint64_t total = static_cast<uint64_t>(_mm512_reduce_add_epi64(sum));
+    long long blockMin = _mm512_reduce_min_epi64(low);
+    long long blockMax = _mm512_reduce_max_epi64(high);
+    for (; i < count; ++i) {
+        total += static_cast<uint64_t>(values[i]);
+        blockMin = std::min(blockMin, values[i]);
+        blockMax = std::max(blockMax, values[i]);
+    }
+    addBlock(moments, values, count, static_cast<long long>(total), blockMin, blockMax);
+}
+
+__attribute__((target("avx512f"))) inline __m512d toDoubleAvx512(__m512i values) {
+    const __m512d bias = _mm512_set1_pd(6755399441055744.0);
+    return _mm512_sub_pd(_mm512_castsi512_pd(_mm512_add_epi64(values, _mm512_castpd_si512(bias))), bias);
+}
+
+__attribute__((target("avx512f"))) double squaredDeviationsAvx512(const long long* values, std::size_t count, double mean) {
+    const __m512d center = _mm512_set1_pd(mean);
+    __m512d acc = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d delta = _mm512_sub_pd(toDoubleAvx512(_mm512_loadu_si512(values + i)), center);
+        acc = _mm512_add_pd(acc, _mm512_mul_pd(delta, delta));
+    }
+    return _mm512_reduce_add_pd(acc) + squaredDeviationsScalar(values + i, count - i, mean);
+}
+
+__attribute__((target("avx512f"))) void binsAvx512(const long long* values, std::size_t count, int precisionBits, uint32_t* bins) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i subBuckets = _mm512_set1_epi64(1LL << precisionBits);
+    const __m512i tooLarge = _mm512_set1_epi64(kExactLimit - 1);
+    const __m512i exponentBias = _mm512_set1_epi64(1023 + precisionBits);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m128i bitsCount = _mm_cvtsi32_si128(precisionBits);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i v = _mm512_loadu_si512(values + i);
+        v = _mm512_mask_blend_epi64(_mm512_cmpgt_epi64_mask(zero, v), v, zero);
+        if (_mm512_cmpgt_epi64_mask(v, tooLarge)) {
+            binsScalar(values + i, 8, precisionBits, bins + i);
+            continue;
+        }
+        __m512i exponent = _mm512_srli_epi64(_mm512_castpd_si512(toDoubleAvx512(v)), 52);
+        __m512i shift = _mm512_sub_epi64(exponent, exponentBias);
+        __m512i large = _mm512_add_epi64(_mm512_sll_epi64(_mm512_add_epi64(shift, one), bitsCount),
+                                         _mm512_sub_epi64(_mm512_srlv_epi64(v, shift), subBuckets));
+        __m512i index = _mm512_mask_blend_epi64(_mm512_cmplt_epi64_mask(v, subBuckets), large, v);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bins + i), _mm512_cvtepi64_epi32(index));
+    }
+    binsScalar(values + i, count - i, precisionBits, bins + i);
+}
+
+template <typename T>
+__attribute__((target("avx512f"))) void resampleAvx512(const T* source, std::size_t sourceCount, ResampleStream& stream, T* out,
+                                                       std::size_t count) {
+    const __m512i range = _mm512_set1_epi64(static_cast<long long>(sourceCount));
+    __m512i s0 = _mm512_loadu_si512(stream.s0);
+    __m512i s1 = _mm512_loadu_si512(stream.s1);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512i x = s0;
+        const __m512i y = s1;
+        s0 = y;
+        x = _mm512_xor_si512(x, _mm512_slli_epi64(x, 23));
+        s1 = _mm512_xor_si512(_mm512_xor_si512(x, y), _mm512_xor_si512(_mm512_srli_epi64(x, 17), _mm512_srli_epi64(y, 26)));
+        __m512i index = _mm512_srli_epi64(_mm512_mul_epu32(_mm512_srli_epi64(_mm512_add_epi64(s1, y), 32), range), 32);
+        _mm512_storeu_si512(out + i, _mm512_i64gather_epi64(index, source, 8));
+    }
+    _mm512_storeu_si512(stream.s0, s0);
+    _mm512_storeu_si512(stream.s1, s1);
+    resampleScalar(source, sourceCount, stream, out + i, count - i);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // PINNACIUM_STATS_X86
+
+SampleMoments sumMinMax(const long long* values, std::size_t count, SimdLevel level) {
+    SampleMoments moments;
+    for (std::size_t begin = 0; begin < count; begin += kSumBlock) {
+        const std::size_t block = std::min(kSumBlock, count - begin);
+        switch (level) {
+#ifdef PINNACIUM_STATS_X86
+        case SimdLevel::Avx512:
+            sumMinMaxBlockAvx512(moments, values + begin, block);
+            break;
+        case SimdLevel::Avx2:
+            sumMinMaxBlockAvx2(moments, values + begin, block);
+            break;
+#endif
+        default:
+            sumMinMaxBlockScalar(moments, values + begin, block);
+            break;
+        }
+    }
+    return moments;
+}
+
+template <typename T>
+void resampleDispatch(const T* source, std::size_t sourceCount, ResampleStream& stream, T* out, std::size_t count) {
+    // Wide sources need the 64x64-bit reduction, which only the scalar path has.
+    const SimdLevel level = sourceCount < kNarrowSource ? statsSimdLevel() : SimdLevel::Scalar;
+    switch (level) {
+#ifdef PINNACIUM_STATS_X86
+    case SimdLevel::Avx512:
+        resampleAvx512(source, sourceCount, stream, out, count);
+        return;
+    case SimdLevel::Avx2:
+        resampleAvx2(source, sourceCount, stream, out, count);
+        return;
+#endif
+    default:
+        resampleScalar(source, sourceCount, stream, out, count);
+        return;
+    }
+}
+
+} // namespace
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Avx512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+SimdLevel detectedSimdLevel() {
+    static const SimdLevel level = detectLevel();
+    return level;
+}
+
+SimdLevel statsSimdLevel() {
+    return activeLevel().load(std::memory_order_relaxed);
+}
+
+void setStatsSimdLevel(SimdLevel level) {
+    activeLevel().store(std::min(level, detectedSimdLevel()), std::memory_order_relaxed);
+}
+
+SampleMoments sampleSumMinMax(const long long* values, std::size_t count) {
+    return sumMinMax(values, count, statsSimdLevel());
+}
+
+SampleMoments sampleMoments(const long long* values, std::size_t count) {
+    const SimdLevel level = statsSimdLevel();
+    SampleMoments moments = sumMinMax(values, count, level);
+    if (count == 0) return moments;
+    const double mean = moments.mean();
+    const bool exact = moments.min > -kExactLimit && moments.max < kExactLimit;
+    switch (exact ? level : SimdLevel::Scalar) {
+#ifdef PINNACIUM_STATS_X86
+    case SimdLevel::Avx512:
+        moments.m2 = squaredDeviationsAvx512(values, count, mean);
+        break;
+    case SimdLevel::Avx2:
+        moments.m2 = squaredDeviationsAvx2(values, count, mean);
+        break;
+#endif
+    default:
+        moments.m2 = squaredDeviationsScalar(values, count, mean);
+        break;
+    }
+    return moments;
+}
+
+void histogramBins(const long long* values, std::size_t count, int precisionBits, uint32_t* bins) {
+    switch (statsSimdLevel()) {
+#ifdef PINNACIUM_STATS_X86
+    case SimdLevel::Avx512:
+        binsAvx512(values, count, precisionBits, bins);
+        return;
+    case SimdLevel::Avx2:
+        binsAvx2(values, count, precisionBits, bins);
+        return;
+#endif
+    default:
+        binsScalar(values, count, precisionBits, bins);
+        return;
+    }
+}
+
+ResampleStream::ResampleStream(uint64_t seed, uint64_t stream) {
+    uint64_t state = seed ^ (stream * 0xd1b54a32d192ed03ULL);
+    for (int lane = 0; lane < kLanes; ++lane) {
+        s0[lane] = splitMix(state);
+        s1[lane] = splitMix(state) | 1; // never an all-zero state
+    }
+}
+
+void resample(const long long* source, std::size_t sourceCount, ResampleStream& stream, long long* out, std::size_t count) {
+    resampleDispatch(source, sourceCount, stream, out, count);
+}
+
+void resample(const double* source, std::size_t sourceCount, ResampleStream& stream, double* out, std::size_t count) {
+    resampleDispatch(source, sourceCount, stream, out, count);
+}
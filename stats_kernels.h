@@ -0,0 +1,61 @@
+#ifndef STATS_KERNELS_H
+#define STATS_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Bulk kernels behind the stats module, vectorized with AVX2 or AVX-512 when the CPU has them and
+// a portable scalar fallback everywhere else. The level is detected once. Integer results, bins and
+// resampled values are identical at every level, so a seed replays the same on any machine; only the
+// floating-point m2 may differ in its last bits.
+
+enum class SimdLevel {
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+const char* simdLevelName(SimdLevel level);
+SimdLevel detectedSimdLevel();
+SimdLevel statsSimdLevel();
+// Caps the level used by the kernels, e.g. Scalar to rule vectorization out; never above the detected one.
+void setStatsSimdLevel(SimdLevel level);
+
+struct SampleMoments {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double m2 = 0.0; // sum of squared deviations from the mean
+    long long min = 0;
+    long long max = 0;
+
+    double mean() const {
+        return count ? sum / static_cast<double>(count) : 0.0;
+    }
+};
+
+// Count, sum, min and max; m2 is left at zero.
+SampleMoments sampleSumMinMax(const long long* values, std::size_t count);
+// Two passes: sum, min and max first, then the squared deviations from the exact mean.
+SampleMoments sampleMoments(const long long* values, std::size_t count);
+
+// Histogram::bucketIndex of max(value, 0) for every value.
+void histogramBins(const long long* values, std::size_t count, int precisionBits, uint32_t* bins);
+
+// Eight interleaved xorshift128+ generators; output element i draws from lane i % 8.
+class ResampleStream {
+public:
+    static constexpr int kLanes = 8;
+
+    // Independent streams for the same seed, one per resample, so any split of the resamples across
+    // workers draws the same values.
+    ResampleStream(uint64_t seed, uint64_t stream);
+
+    uint64_t s0[kLanes];
+    uint64_t s1[kLanes];
+};
+
+// out[i] = source[uniform index below sourceCount] for i < count; sourceCount must be non-zero.
+void resample(const long long* source, std::size_t sourceCount, ResampleStream& stream, long long* out, std::size_t count);
+void resample(const double* source, std::size_t sourceCount, ResampleStream& stream, double* out, std::size_t count);
+
+#endif // STATS_KERNELS_H
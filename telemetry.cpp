@@ -0,0 +1,291 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+constexpr const char* kQuantileNames[] = {"p50", "p90", "p99", "p999"};
+
+double secondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+// Bucket counts only: min and max become the outer bucket bounds and the sum uses bucket midpoints.
+Histogram histogramFromCounts(const Histogram& layout, const std::vector<uint64_t>& counts) {
+    Histogram histogram(layout.precisionBits());
+    std::vector<std::pair<std::size_t, uint64_t>> buckets;
+    double sum = 0.0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (!counts[i]) continue;
+        buckets.emplace_back(i, counts[i]);
+        sum += static_cast<double>(counts[i]) * (static_cast<double>(layout.bucketLow(i)) + static_cast<double>(layout.bucketHigh(i))) / 2.0;
+    }
+    if (buckets.empty()) return histogram;
+    histogram.restore(buckets, layout.bucketLow(buckets.front().first), layout.bucketHigh(buckets.back().first), sum);
+    return histogram;
+}
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+std::string prometheusLabel(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void writeAll(int fd, const std::string& text) {
+    std::size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t written = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return;
+        sent += static_cast<std::size_t>(written);
+    }
+}
+
+} // namespace
+
+LiveHistogram::LiveHistogram(int precisionBits)
+    : layout_(precisionBits), counts_(std::make_unique<std::atomic<uint64_t>[]>(layout_.bucketCount())) {
+    for (std::size_t i = 0; i < layout_.bucketCount(); ++i) counts_[i].store(0, std::memory_order_relaxed);
+}
+
+uint64_t LiveHistogram::accumulate(std::vector<uint64_t>& counts) const {
+    const std::size_t buckets = std::min(counts.size(), layout_.bucketCount());
+    for (std::size_t i = 0; i < buckets; ++i) counts[i] += counts_[i].load(std::memory_order_relaxed);
+    return operations_.load(std::memory_order_relaxed);
+}
+
+const Histogram& LiveHistogram::layout() const {
+    return layout_;
+}
+
+ConsoleTelemetry::ConsoleTelemetry(std::FILE* out) : out_(out) {}
+
+void ConsoleTelemetry::publish(const TelemetrySnapshot& snapshot) {
+    std::fprintf(out_, "[%s] %s t=%.1fs %.0f ops/s", snapshot.finished ? "done" : "live", snapshot.benchmark.c_str(),
+                 snapshot.elapsedSeconds, snapshot.opsPerSecond);
+    const Histogram& latency = snapshot.latency;
+    if (latency.count() > 0) {
+        std::fprintf(out_, " p50=%llu ns p99=%llu ns max=%llu ns", static_cast<unsigned long long>(latency.quantile(0.5)),
+                     static_cast<unsigned long long>(latency.quantile(0.99)), static_cast<unsigned long long>(latency.max()));
+    }
+    std::fprintf(out_, " (%llu ops)\n", static_cast<unsigned long long>(snapshot.totalOperations));
+    std::fflush(out_);
+}
+
+NdjsonTelemetry::NdjsonTelemetry(const std::string& path)
+    : out_(path == "-" ? stdout : std::fopen(path.c_str(), "w")), owned_(path != "-") {}
+
+NdjsonTelemetry::~NdjsonTelemetry() {
+    if (owned_ && out_) std::fclose(out_);
+}
+
+bool NdjsonTelemetry::ok() const {
+    return out_ != nullptr;
+}
+
+void NdjsonTelemetry::publish(const TelemetrySnapshot& snapshot) {
+    if (!out_) return;
+    std::ostringstream line;
+    line << "{\"benchmark\":" << jsonString(snapshot.benchmark) << ",\"elapsed_s\":" << snapshot.elapsedSeconds
+         << ",\"window_s\":" << snapshot.windowSeconds << ",\"operations\":" << snapshot.operations
+         << ",\"total_operations\":" << snapshot.totalOperations << ",\"ops_per_second\":" << snapshot.opsPerSecond;
+    const Histogram& latency = snapshot.latency;
+    if (latency.count() > 0) {
+        for (std::size_t q = 0; q < std::size(kQuantiles); ++q) {
+            line << ",\"" << kQuantileNames[q] << "_ns\":" << latency.quantile(kQuantiles[q]);
+        }
+        line << ",\"max_ns\":" << latency.max();
+    }
+    line << ",\"final\":" << (snapshot.finished ? "true" : "false") << "}\n";
+    const std::string text = line.str();
+    std::fwrite(text.data(), 1, text.size(), out_);
+    std::fflush(out_);
+}
+
+PrometheusTelemetry::PrometheusTelemetry(uint16_t port) {
+    socket_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_ < 0) {
+        error_ = std::string("socket: ") + std::strerror(errno);
+        return;
+    }
+    int enable = 1;
+    ::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(socket_, 16) != 0) {
+        error_ = "listen on port " + std::to_string(port) + ": " + std::strerror(errno);
+        ::close(socket_);
+        socket_ = -1;
+        return;
+    }
+    thread_ = std::thread([this] { serve(); });
+}
+
+PrometheusTelemetry::~PrometheusTelemetry() {
+    stop_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable()) thread_.join();
+    if (socket_ >= 0) ::close(socket_);
+}
+
+bool PrometheusTelemetry::ok() const {
+    return socket_ >= 0;
+}
+
+const std::string& PrometheusTelemetry::error() const {
+    return error_;
+}
+
+void PrometheusTelemetry::publish(const TelemetrySnapshot& snapshot) {
+    const std::string labels = "benchmark=\"" + prometheusLabel(snapshot.benchmark) + "\"";
+    std::ostringstream page;
+    page << "# HELP pinnacium_operations_total Operations completed in the current timed phase.\n"
+         << "# TYPE pinnacium_operations_total counter\n"
+         << "pinnacium_operations_total{" << labels << "} " << snapshot.totalOperations << "\n"
+         << "# HELP pinnacium_ops_per_second Operation rate over the reporting window.\n"
+         << "# TYPE pinnacium_ops_per_second gauge\n"
+         << "pinnacium_ops_per_second{" << labels << "} " << snapshot.opsPerSecond << "\n"
+         << "# HELP pinnacium_elapsed_seconds Time since the timed phase started.\n"
+         << "# TYPE pinnacium_elapsed_seconds gauge\n"
+         << "pinnacium_elapsed_seconds{" << labels << "} " << snapshot.elapsedSeconds << "\n";
+    const Histogram& latency = snapshot.latency;
+    if (latency.count() > 0) {
+        page << "# HELP pinnacium_latency_ns Per-call latency quantiles over the reporting window.\n"
+             << "# TYPE pinnacium_latency_ns summary\n";
+        for (double q : kQuantiles) {
+            page << "pinnacium_latency_ns{" << labels << ",quantile=\"" << q << "\"} " << latency.quantile(q) << "\n";
+        }
+        page << "pinnacium_latency_ns_sum{" << labels << "} " << latency.sum() << "\n"
+             << "pinnacium_latency_ns_count{" << labels << "} " << latency.count() << "\n";
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    page_ = page.str();
+}
+
+// Polls so the destructor can stop it; every connection gets the latest page and is closed.
+void PrometheusTelemetry::serve() {
+    while (!stop_.load(std::memory_order_relaxed)) {
+        pollfd descriptor{socket_, POLLIN, 0};
+        if (::poll(&descriptor, 1, 100) <= 0) continue;
+        int client = ::accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) continue;
+
+        // The request itself is not inspected; read what has arrived so the client sees a clean close.
+        char request[1024];
+        pollfd incoming{client, POLLIN, 0};
+        if (::poll(&incoming, 1, 1000) > 0) (void)::recv(client, request, sizeof(request), 0);
+
+        std::string body;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            body = page_;
+        }
+        writeAll(client, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                             std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+        ::close(client);
+    }
+}
+
+TelemetryReporter::~TelemetryReporter() {
+    stop();
+}
+
+void TelemetryReporter::start(std::string benchmark, std::vector<const LiveHistogram*> sources, TelemetryOptions options,
+                              std::vector<std::shared_ptr<TelemetrySink>> sinks) {
+    stop();
+    benchmark_ = std::move(benchmark);
+    sources_ = std::move(sources);
+    options_ = options;
+    options_.interval = std::max(options_.interval, std::chrono::milliseconds(1));
+    options_.windowIntervals = std::max(options_.windowIntervals, 1);
+    sinks_ = std::move(sinks);
+    if (sources_.empty() || sinks_.empty()) return;
+
+    origin_ = sample();
+    window_.assign(1, origin_);
+    stopping_ = false;
+    thread_ = std::thread([this] { loop(); });
+}
+
+void TelemetryReporter::stop() {
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    publish(origin_, sample(), true);
+}
+
+void TelemetryReporter::loop() {
+    auto next = origin_.time + options_.interval;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_until(lock, next, [this] { return stopping_; })) {
+        lock.unlock();
+        Point now = sample();
+        publish(window_.front(), now, false);
+        window_.push_back(std::move(now));
+        if (static_cast<int>(window_.size()) > options_.windowIntervals) window_.pop_front();
+        next += options_.interval;
+        lock.lock();
+    }
+}
+
+TelemetryReporter::Point TelemetryReporter::sample() const {
+    Point point;
+    point.counts.assign(sources_.front()->layout().bucketCount(), 0);
+    for (const LiveHistogram* source : sources_) point.operations += source->accumulate(point.counts);
+    point.time = std::chrono::steady_clock::now();
+    return point;
+}
+
+void TelemetryReporter::publish(const Point& from, const Point& to, bool finished) {
+    TelemetrySnapshot snapshot;
+    snapshot.benchmark = benchmark_;
+    snapshot.elapsedSeconds = secondsBetween(origin_.time, to.time);
+    snapshot.windowSeconds = secondsBetween(from.time, to.time);
+    snapshot.operations = to.operations - from.operations;
+    snapshot.totalOperations = to.operations - origin_.operations;
+    snapshot.opsPerSecond = snapshot.windowSeconds > 0.0 ? static_cast<double>(snapshot.operations) / snapshot.windowSeconds : 0.0;
+    std::vector<uint64_t> counts(to.counts.size());
+    for (std::size_t i = 0; i < counts.size(); ++i) counts[i] = to.counts[i] - from.counts[i];
+    snapshot.latency = histogramFromCounts(sources_.front()->layout(), counts);
+    snapshot.finished = finished;
+    for (const auto& sink : sinks_) sink->publish(snapshot);
+}
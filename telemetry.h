@@ -0,0 +1,155 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stats.h"
+
+// Histogram written by one worker and read concurrently by the reporter thread. Buckets and the
+// operation count are relaxed atomics updated with a plain load and store (there is a single writer),
+// so recording costs the same as a Histogram and never locks; intervals are differences of snapshots.
+class alignas(64) LiveHistogram {
+public:
+    explicit LiveHistogram(int precisionBits = 7);
+
+    void record(uint64_t value, uint64_t operations = 1) {
+        auto& bucket = counts_[layout_.bucketIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        addOperations(operations);
+    }
+
+    // Counts operations that are not timed one by one (throughput mode).
+    void addOperations(uint64_t operations) {
+        operations_.store(operations_.load(std::memory_order_relaxed) + operations, std::memory_order_relaxed);
+    }
+
+    // Adds the current bucket counts into counts (sized to bucketCount()) and returns the operations.
+    uint64_t accumulate(std::vector<uint64_t>& counts) const;
+    const Histogram& layout() const;
+
+private:
+    Histogram layout_; // bucket arithmetic only; never recorded into
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> operations_{0};
+};
+
+struct TelemetrySnapshot {
+    std::string benchmark;
+    double elapsedSeconds = 0.0; // since the timed phase started
+    double windowSeconds = 0.0;  // span the rate and latency cover
+    uint64_t operations = 0;     // in the window
+    uint64_t totalOperations = 0;
+    double opsPerSecond = 0.0;
+    Histogram latency; // calls timed in the window; empty in throughput mode
+    bool finished = false; // the whole-run snapshot published once the timed phase is over
+};
+
+class TelemetrySink {
+public:
+    virtual ~TelemetrySink() = default;
+    // Called from the reporter thread only.
+    virtual void publish(const TelemetrySnapshot& snapshot) = 0;
+};
+
+// One human-readable line per snapshot, on stderr by default so result output stays parseable.
+class ConsoleTelemetry : public TelemetrySink {
+public:
+    explicit ConsoleTelemetry(std::FILE* out = stderr);
+    void publish(const TelemetrySnapshot& snapshot) override;
+
+private:
+    std::FILE* out_;
+};
+
+// One JSON object per line, flushed after each snapshot; "-" writes to stdout.
+class NdjsonTelemetry : public TelemetrySink {
+public:
+    explicit NdjsonTelemetry(const std::string& path);
+    ~NdjsonTelemetry() override;
+    NdjsonTelemetry(const NdjsonTelemetry&) = delete;
+    NdjsonTelemetry& operator=(const NdjsonTelemetry&) = delete;
+
+    bool ok() const;
+    void publish(const TelemetrySnapshot& snapshot) override;
+
+private:
+    std::FILE* out_;
+    bool owned_;
+};
+
+// Serves the latest snapshot in the Prometheus text format to any HTTP GET on the port
+// (conventionally /metrics), from its own thread.
+class PrometheusTelemetry : public TelemetrySink {
+public:
+    explicit PrometheusTelemetry(uint16_t port = 9464);
+    ~PrometheusTelemetry() override;
+    PrometheusTelemetry(const PrometheusTelemetry&) = delete;
+    PrometheusTelemetry& operator=(const PrometheusTelemetry&) = delete;
+
+    bool ok() const;
+    const std::string& error() const;
+    void publish(const TelemetrySnapshot& snapshot) override;
+
+private:
+    void serve();
+
+    int socket_ = -1;
+    std::string error_;
+    std::atomic<bool> stop_{false};
+    std::mutex mutex_;
+    std::string page_;
+    std::thread thread_;
+};
+
+struct TelemetryOptions {
+    std::chrono::milliseconds interval = std::chrono::seconds(1); // between snapshots
+    int windowIntervals = 1; // snapshots report the last windowIntervals intervals
+};
+
+// Background thread that wakes every interval, sums the workers' live histograms and publishes the
+// difference against the window's oldest sum, then a final whole-run snapshot on stop().
+class TelemetryReporter {
+public:
+    TelemetryReporter() = default;
+    ~TelemetryReporter();
+    TelemetryReporter(const TelemetryReporter&) = delete;
+    TelemetryReporter& operator=(const TelemetryReporter&) = delete;
+
+    void start(std::string benchmark, std::vector<const LiveHistogram*> sources, TelemetryOptions options,
+               std::vector<std::shared_ptr<TelemetrySink>> sinks);
+    void stop();
+
+private:
+    struct Point {
+        std::chrono::steady_clock::time_point time;
+        std::vector<uint64_t> counts;
+        uint64_t operations = 0;
+    };
+
+    void loop();
+    Point sample() const;
+    void publish(const Point& from, const Point& to, bool finished);
+
+    std::string benchmark_;
+    std::vector<const LiveHistogram*> sources_;
+    TelemetryOptions options_;
+    std::vector<std::shared_ptr<TelemetrySink>> sinks_;
+    Point origin_;
+    std::deque<Point> window_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,203 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr int kSpinsBeforeYield = 1 << 14;
+// About a hundred microseconds of pause loops: back-to-back iterations find their workers still
+// spinning, while an idle pool or an unused part of a thread sweep goes to sleep.
+constexpr int kSpinsBeforeSleep = 1 << 14;
+
+long long nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+SpinBarrier::SpinBarrier(int count) : count_(count) {}
+
+void SpinBarrier::arriveAndWait() {
+    unsigned phase = phase_.load(std::memory_order_acquire);
+    if (waiting_.fetch_add(1, std::memory_order_acq_rel) + 1 == count_) {
+        waiting_.store(0, std::memory_order_relaxed);
+        phase_.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    while (phase_.load(std::memory_order_acquire) == phase) {
+        cpuRelax();
+    }
+}
+
+void SpinBarrier::reset(int count) {
+    count_ = count;
+    waiting_.store(0, std::memory_order_relaxed);
+}
+
+InlineExecutor::InlineExecutor(const ExecutionPolicy& policy) : placement_(policy) {}
+
+void InlineExecutor::run(const Task& task, int) {
+    task(0);
+}
+
+void InlineExecutor::startTogether(int) {}
+
+int InlineExecutor::size() const {
+    return 1;
+}
+
+long long InlineExecutor::lastStartSkew() const {
+    return 0;
+}
+
+int InlineExecutor::workerCpu(int) const {
+    return placement_.cpu();
+}
+
+bool InlineExecutor::realtime() const {
+    return placement_.realtime();
+}
+
+ThreadPool::ThreadPool(int threads, bool pinThreads)
+    : ThreadPool(threads, ExecutionPolicy{{}, pinThreads, false, 1}) {}
+
+ThreadPool::ThreadPool(int threads, ExecutionPolicy policy)
+    : slots_(std::max(threads, 1)), policy_(std::move(policy)), startBarrier_(std::max(threads, 1)), activeThreads_(std::max(threads, 1)) {
+    if (policy_.cpus.empty()) policy_.cpus = allowedCpus();
+    remaining_.store(size(), std::memory_order_relaxed);
+    for (int t = 0; t < size(); ++t) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, t);
+    }
+    while (remaining_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stop_.store(true, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+        for (auto& slot : slots_) slot.wake.notify_one();
+    }
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(const Task& task) {
+    run(task, size());
+}
+
+void ThreadPool::run(const Task& task, int activeThreads) {
+    activeThreads = std::clamp(activeThreads, 1, size());
+    if (activeThreads != activeThreads_.load(std::memory_order_relaxed)) startBarrier_.reset(activeThreads);
+    for (auto& slot : slots_) {
+        slot.startNs = 0;
+    }
+    task_ = &task;
+    remaining_.store(activeThreads, std::memory_order_relaxed);
+    {
+        // Under the mutex so a worker cannot miss the generation between checking it and sleeping.
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        activeThreads_.store(activeThreads, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+        for (int t = 0; t < activeThreads; ++t) {
+            if (slots_[t].sleeping) slots_[t].wake.notify_one();
+        }
+    }
+
+    int spins = 0;
+    while (remaining_.load(std::memory_order_acquire) != 0) {
+        if (++spins < kSpinsBeforeYield) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    task_ = nullptr;
+
+    long long first = std::numeric_limits<long long>::max();
+    long long last = 0;
+    for (int t = 0; t < activeThreads; ++t) {
+        const WorkerSlot& slot = slots_[t];
+        if (slot.startNs == 0) {
+            lastStartSkew_ = 0;
+            return;
+        }
+        first = std::min(first, slot.startNs);
+        last = std::max(last, slot.startNs);
+    }
+    lastStartSkew_ = last - first;
+}
+
+void ThreadPool::startTogether(int threadIndex) {
+    startBarrier_.arriveAndWait();
+    slots_[threadIndex].startNs = nowNs();
+}
+
+int ThreadPool::size() const {
+    return static_cast<int>(slots_.size());
+}
+
+long long ThreadPool::lastStartSkew() const {
+    return lastStartSkew_;
+}
+
+int ThreadPool::workerCpu(int threadIndex) const {
+    return slots_[threadIndex].cpu;
+}
+
+bool ThreadPool::realtime() const {
+    for (const auto& slot : slots_) {
+        if (!slot.realtime) return false;
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop(int threadIndex) {
+    placeCurrentThread(threadIndex);
+    remaining_.fetch_sub(1, std::memory_order_release);
+
+    uint64_t seen = 0;
+    for (;;) {
+        awaitWork(threadIndex, seen);
+        seen = generation_.load(std::memory_order_acquire);
+        if (stop_.load(std::memory_order_relaxed)) return;
+
+        (*task_)(threadIndex);
+        remaining_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void ThreadPool::awaitWork(int threadIndex, uint64_t seen) {
+    const auto ready = [&] {
+        if (stop_.load(std::memory_order_relaxed)) return true;
+        return generation_.load(std::memory_order_acquire) != seen &&
+               threadIndex < activeThreads_.load(std::memory_order_relaxed);
+    };
+    for (int spins = 0; spins < kSpinsBeforeSleep; ++spins) {
+        if (ready()) return;
+        cpuRelax();
+    }
+    WorkerSlot& slot = slots_[threadIndex];
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    slot.sleeping = true;
+    slot.wake.wait(lock, ready);
+    slot.sleeping = false;
+}
+
+void ThreadPool::placeCurrentThread(int threadIndex) {
+    WorkerSlot& slot = slots_[threadIndex];
+    if (policy_.pin && !policy_.cpus.empty()) {
+        int cpu = policy_.cpus[threadIndex % policy_.cpus.size()];
+        if (pinCurrentThread(cpu)) slot.cpu = cpu;
+    }
+    if (policy_.realtime) {
+        slot.realtime = setRealtimeScheduling(true, policy_.realtimePriority);
+    }
+}
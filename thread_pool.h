@@ -0,0 +1,124 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "environment.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // For _mm_pause
+#endif
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+class SpinBarrier {
+public:
+    explicit SpinBarrier(int count);
+
+    void arriveAndWait();
+    // Only while no thread is waiting.
+    void reset(int count);
+
+private:
+    int count_;
+    alignas(64) std::atomic<int> waiting_{0};
+    alignas(64) std::atomic<unsigned> phase_{0};
+};
+
+// Runs per-worker tasks for the measurement engine: a ThreadPool for multi-threaded benchmarks,
+// an InlineExecutor for a single worker on the calling thread.
+class Executor {
+public:
+    using Task = std::function<void(int)>;
+
+    virtual ~Executor() = default;
+
+    // Runs task(threadIndex) on workers [0, activeThreads) and blocks until all of them return.
+    virtual void run(const Task& task, int activeThreads) = 0;
+    // Called from inside a task: releases all active workers at once.
+    virtual void startTogether(int threadIndex) = 0;
+
+    virtual int size() const = 0;
+    virtual long long lastStartSkew() const = 0;
+    virtual int workerCpu(int threadIndex) const = 0; // -1 when the worker is not pinned
+    virtual bool realtime() const = 0;                // true when every worker runs SCHED_FIFO
+};
+
+// One worker: the calling thread, placed by the policy for the executor's lifetime.
+class InlineExecutor : public Executor {
+public:
+    explicit InlineExecutor(const ExecutionPolicy& policy);
+
+    void run(const Task& task, int activeThreads) override;
+    void startTogether(int threadIndex) override;
+
+    int size() const override;
+    long long lastStartSkew() const override;
+    int workerCpu(int threadIndex) const override;
+    bool realtime() const override;
+
+private:
+    ScopedThreadPlacement placement_;
+};
+
+class ThreadPool : public Executor {
+public:
+    explicit ThreadPool(int threads, bool pinThreads = true);
+    // Worker t is pinned to CPU t of the policy's set (wrapping around) before the constructor returns.
+    ThreadPool(int threads, ExecutionPolicy policy);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs task(threadIndex) once on every worker and blocks until all of them return.
+    void run(const Task& task);
+    // Same, on workers [0, activeThreads) only; the others are neither woken nor counted, and stay
+    // blocked so they take no CPU time, SMT sibling or turbo budget from the active ones.
+    void run(const Task& task, int activeThreads) override;
+    // Also records each worker's start time for lastStartSkew().
+    void startTogether(int threadIndex) override;
+
+    int size() const override;
+    long long lastStartSkew() const override;
+    int workerCpu(int threadIndex) const override;
+    bool realtime() const override;
+
+private:
+    struct alignas(64) WorkerSlot {
+        long long startNs = 0;
+        int cpu = -1;
+        bool realtime = false;
+        bool sleeping = false; // guarded by wakeMutex_
+        std::condition_variable wake;
+    };
+
+    void workerLoop(int threadIndex);
+    // Spins briefly for a generation this worker takes part in, then blocks until run() wakes it.
+    void awaitWork(int threadIndex, uint64_t seen);
+    void placeCurrentThread(int threadIndex);
+
+    std::vector<std::thread> workers_;
+    std::vector<WorkerSlot> slots_;
+    ExecutionPolicy policy_;
+    SpinBarrier startBarrier_;
+    const Task* task_ = nullptr;
+    std::atomic<int> activeThreads_{0};
+    long long lastStartSkew_ = 0;
+    alignas(64) std::atomic<uint64_t> generation_{0};
+    alignas(64) std::atomic<int> remaining_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex wakeMutex_;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,59 @@
+#include "throughput.h"
+
+#include <algorithm>
+#include <iostream>
+
+long long ThroughputResult::operations() const {
+    long long total = 0;
+    for (const auto& worker : workers) total += worker.operations;
+    return total;
+}
+
+double ThroughputResult::seconds() const {
+    long long longest = 0;
+    for (const auto& worker : workers) longest = std::max(longest, worker.elapsedNs);
+    return static_cast<double>(longest) * 1e-9;
+}
+
+double ThroughputResult::opsPerSecond() const {
+    double elapsed = seconds();
+    return elapsed > 0.0 ? static_cast<double>(operations()) / elapsed : 0.0;
+}
+
+double ThroughputResult::bytesPerSecond() const {
+    return opsPerSecond() * static_cast<double>(bytesPerOp);
+}
+
+double ThroughputResult::itemsPerSecond() const {
+    return opsPerSecond() * static_cast<double>(itemsPerOp);
+}
+
+StopTimer::StopTimer(std::atomic<bool>& stop, std::chrono::nanoseconds duration) : stop_(stop) {
+    stop_.store(false, std::memory_order_relaxed);
+    thread_ = std::thread([this, duration] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cancelled_.wait_for(lock, duration, [this] { return cancel_; });
+        stop_.store(true, std::memory_order_relaxed);
+    });
+}
+
+StopTimer::~StopTimer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancel_ = true;
+    }
+    cancelled_.notify_one();
+    thread_.join();
+}
+
+void printThroughput(const ThroughputResult& result) {
+    std::cout << "Duration: " << result.seconds() << " s" << std::endl;
+    std::cout << "Operations: " << result.operations() << std::endl;
+    std::cout << "Throughput: " << result.opsPerSecond() << " ops/s" << std::endl;
+    if (result.bytesPerOp > 0) {
+        std::cout << "Bandwidth: " << result.bytesPerSecond() * 1e-9 << " GB/s" << std::endl;
+    }
+    if (result.itemsPerOp > 0) {
+        std::cout << "Items: " << result.itemsPerSecond() << " items/s" << std::endl;
+    }
+}
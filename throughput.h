@@ -0,0 +1,48 @@
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Outcome of a fixed-duration run. Bytes and items per op are declared by the user; 0 means not reported.
+struct ThroughputResult {
+    struct alignas(64) Worker {
+        long long operations = 0;
+        long long elapsedNs = 0;
+    };
+
+    std::vector<Worker> workers;
+    long long bytesPerOp = 0;
+    long long itemsPerOp = 0;
+
+    long long operations() const;
+    double seconds() const; // longest worker window
+    double opsPerSecond() const;
+    double bytesPerSecond() const;
+    double itemsPerSecond() const;
+};
+
+// Sets the flag from a helper thread once the duration has passed; the measured threads only poll it.
+class StopTimer {
+public:
+    StopTimer(std::atomic<bool>& stop, std::chrono::nanoseconds duration);
+    ~StopTimer(); // stops early if the duration has not passed yet
+
+    StopTimer(const StopTimer&) = delete;
+    StopTimer& operator=(const StopTimer&) = delete;
+
+private:
+    std::atomic<bool>& stop_;
+    std::mutex mutex_;
+    std::condition_variable cancelled_;
+    bool cancel_ = false;
+    std::thread thread_;
+};
+
+void printThroughput(const ThroughputResult& result);
+
+#endif // THROUGHPUT_H
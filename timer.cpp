@@ -0,0 +1,99 @@
+#include "timer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+constexpr int kOverheadSamples = 2000;
+constexpr auto kCalibrationWindow = std::chrono::milliseconds(20);
+
+template <typename T>
+double measureOverheadTicks() {
+    std::vector<uint64_t> samples(kOverheadSamples);
+    for (auto& sample : samples) {
+        uint64_t start = T::start();
+        uint64_t end = T::stop();
+        sample = end - start;
+    }
+    std::nth_element(samples.begin(), samples.begin() + kOverheadSamples / 2, samples.end());
+    return static_cast<double>(samples[kOverheadSamples / 2]);
+}
+
+bool hasInvariantTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) && eax >= 0x80000007) {
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return (edx & (1u << 8)) != 0;
+    }
+#endif
+    return false;
+}
+
+double calibrateTscNsPerTick() {
+    using Clock = std::chrono::steady_clock;
+    auto wallStart = Clock::now();
+    uint64_t tscStart = TscTimer::start();
+    while (Clock::now() - wallStart < kCalibrationWindow) {
+    }
+    uint64_t tscEnd = TscTimer::stop();
+    auto wallEnd = Clock::now();
+
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - wallStart).count());
+    return tscEnd > tscStart ? ns / static_cast<double>(tscEnd - tscStart) : 1.0;
+}
+
+TimerCalibration calibrateChrono() {
+    TimerCalibration calibration;
+    calibration.kind = TimerKind::Chrono;
+    calibration.nsPerTick = static_cast<double>(std::chrono::steady_clock::period::num) * 1e9 /
+                            static_cast<double>(std::chrono::steady_clock::period::den);
+    calibration.overheadTicks = measureOverheadTicks<ChronoTimer>();
+    return calibration;
+}
+
+TimerCalibration calibrateTsc() {
+    TimerCalibration calibration;
+    calibration.kind = TimerKind::Tsc;
+    calibration.invariantTsc = hasInvariantTsc();
+    if (!calibration.invariantTsc) {
+        std::cerr << "Warning: TSC is not invariant; tsc timings may drift with frequency changes" << std::endl;
+    }
+    calibration.nsPerTick = calibrateTscNsPerTick();
+    calibration.overheadTicks = measureOverheadTicks<TscTimer>();
+    return calibration;
+}
+
+} // namespace
+
+bool isTscAvailable() {
+#if defined(__x86_64__) || defined(__i386__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* timerName(TimerKind kind) {
+    switch (kind) {
+    case TimerKind::Tsc:
+        return "tsc";
+    case TimerKind::Chrono:
+    default:
+        return "chrono";
+    }
+}
+
+const TimerCalibration& timerCalibration(TimerKind kind) {
+    static const TimerCalibration chrono = calibrateChrono();
+    if (kind == TimerKind::Tsc && isTscAvailable()) {
+        static const TimerCalibration tsc = calibrateTsc();
+        return tsc;
+    }
+    return chrono;
+}
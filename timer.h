@@ -0,0 +1,73 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc/__rdtscp
+#endif
+
+enum class TimerKind {
+    Chrono,
+    Tsc,
+};
+
+struct ChronoTimer {
+    static uint64_t start() {
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    static uint64_t stop() {
+        return start();
+    }
+};
+
+// lfence-serialized rdtsc at the start and rdtscp + lfence at the end, so the
+// timed instructions can neither start before the first read nor retire after the second.
+struct TscTimer {
+    static uint64_t start() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_lfence();
+        uint64_t ticks = __rdtsc();
+        _mm_lfence();
+        return ticks;
+#else
+        return ChronoTimer::start();
+#endif
+    }
+
+    static uint64_t stop() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int aux;
+        uint64_t ticks = __rdtscp(&aux);
+        _mm_lfence();
+        return ticks;
+#else
+        return ChronoTimer::stop();
+#endif
+    }
+};
+
+struct TimerCalibration {
+    TimerKind kind = TimerKind::Chrono;
+    double nsPerTick = 1.0;
+    double overheadTicks = 0.0;
+    bool invariantTsc = false;
+
+    double overheadNs() const {
+        return overheadTicks * nsPerTick;
+    }
+
+    // Converts a raw start/stop tick delta to nanoseconds with the empty-region overhead removed.
+    long long toNs(uint64_t ticks) const {
+        double net = static_cast<double>(ticks) - overheadTicks;
+        return net > 0.0 ? static_cast<long long>(net * nsPerTick + 0.5) : 0;
+    }
+};
+
+bool isTscAvailable();
+const char* timerName(TimerKind kind);
+// Calibrates frequency and overhead once per process and caches the result.
+const TimerCalibration& timerCalibration(TimerKind kind);
+
+#endif // TIMER_H
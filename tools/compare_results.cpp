@@ -0,0 +1,80 @@
+// Compares a current run against a baseline and fails when a benchmark regressed.
+//
+//   compare_results [--threshold 0.05] [--alpha 0.05] [--test mwu|bootstrap] [--resamples N] baseline current
+//
+// baseline and current are result files (".csv" or ".pinb") or directories of them; benchmarks are
+// matched by name. Exits with 1 when any benchmark is significantly slower by more than the threshold,
+// 2 on usage or read errors, and 0 otherwise.
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "compare.h"
+#include "thread_pool.h"
+
+namespace {
+
+int usage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [--threshold 0.05] [--alpha 0.05] [--test mwu|bootstrap] [--resamples N] baseline current"
+              << std::endl;
+    return 2;
+}
+
+bool parsePositive(const char* text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0' && value > 0.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CompareOptions options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) return usage(argv[0]);
+        const char* value = argv[++i];
+        double number = 0.0;
+        if (arg == "--threshold" && parsePositive(value, number)) {
+            options.threshold = number;
+        } else if (arg == "--alpha" && parsePositive(value, number) && number < 1.0) {
+            options.alpha = number;
+        } else if (arg == "--resamples" && parsePositive(value, number)) {
+            options.resamples = static_cast<int>(number);
+        } else if (arg == "--test" && std::string(value) == "mwu") {
+            options.test = SignificanceTest::MannWhitney;
+        } else if (arg == "--test" && std::string(value) == "bootstrap") {
+            options.test = SignificanceTest::Bootstrap;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (paths.size() != 2) return usage(argv[0]);
+
+    std::vector<ResultTable> baseline, current;
+    std::string error;
+    if (!loadResults(paths[0], baseline, error) || !loadResults(paths[1], current, error)) {
+        std::cerr << "Failed to load results: " << error << std::endl;
+        return 2;
+    }
+
+    // Bootstrap resamples are spread over every CPU; the pool only exists while comparing.
+    std::unique_ptr<ThreadPool> pool;
+    if (options.test == SignificanceTest::Bootstrap) {
+        pool = std::make_unique<ThreadPool>(static_cast<int>(std::thread::hardware_concurrency()), false);
+        options.executor = pool.get();
+    }
+    ComparisonReport report = compareResults(baseline, current, options);
+    printComparison(report, options);
+    return report.regressions() ? 1 : 0;
+}
@@ -0,0 +1,41 @@
+// Converts a binary result file (".pinb") written by BinarySink back to CSV.
+//
+//   convert_results input.pinb [output.csv]
+//
+// Without an output path the CSV is written to stdout.
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "result_sink.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " input.pinb [output.csv]" << std::endl;
+        return 2;
+    }
+
+    ResultTable table;
+    std::string error;
+    if (!readBinaryResults(argv[1], table, error)) {
+        std::cerr << "Failed to read " << argv[1] << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (argc == 3) {
+        out = std::fopen(argv[2], "wb");
+        if (!out) {
+            std::cerr << "Failed to open " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    bool ok = writeCsv(table, out);
+    if (out != stdout) ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Failed to write CSV" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+// Characterizes the host: dependent-load latency from L1 to DRAM, STREAM bandwidth per thread count
+// and core-to-core cache-line latency, then a normalized summary.
+//
+//   probe_suite [--peak-gbs GB/s] [--all-pairs] [runner options]
+//
+// --peak-gbs normalizes bandwidth to the machine's theoretical peak instead of the best measured
+// figure; the runner options (--filter, --repetitions, --shuffle, --list) select and repeat probes,
+// and repeated figures are merged into their median in the summary.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "probes.h"
+#include "registry.h"
+
+int main(int argc, char** argv) {
+    ProbeOptions options;
+    std::vector<char*> runnerArgs{argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--peak-gbs") == 0 && i + 1 < argc) {
+            options.peakBandwidthGBs = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--all-pairs") == 0) {
+            options.allPairs = true;
+        } else {
+            runnerArgs.push_back(argv[i]);
+        }
+    }
+    RunnerOptions runner;
+    if (!parseRunnerOptions(static_cast<int>(runnerArgs.size()), runnerArgs.data(), runner)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--peak-gbs GB/s] [--all-pairs] [--filter=REGEX] [--repetitions=N] [--shuffle[=SEED]] [--list]"
+                  << std::endl;
+        return 1;
+    }
+    registerProbeSuite(options);
+    int status = runRegisteredBenchmarks(runner);
+    // After every probe and repetition, whatever order the runner chose.
+    if (status == 0 && !runner.list) writeProbeSummary(options);
+    return status;
+}
@@ -0,0 +1,216 @@
+#include "topdown.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+// Raw encodings: event | umask << 8 | cmask << 24 (Intel), and AMD's extended event bits 11:8 at 35:32.
+const TopDownModel kIntelModel{
+    TopDownVendor::Intel,
+    "Intel TMA (Skylake, 4-wide)",
+    4,
+    {
+        {"cycles", "r019c" /* IDQ_UOPS_NOT_DELIVERED.CORE */, "r010e" /* UOPS_ISSUED.ANY */,
+         "r02c2" /* UOPS_RETIRED.RETIRE_SLOTS */},
+        {"cycles", "r010d" /* INT_MISC.RECOVERY_CYCLES */, "r0400019c" /* IDQ_UOPS_NOT_DELIVERED.CYCLES_0_UOPS_DELIV.CORE */,
+         "r00c5" /* BR_MISP_RETIRED.ALL_BRANCHES */},
+        {"cycles", "r10401c3" /* MACHINE_CLEARS.COUNT */, "r140014a3" /* CYCLE_ACTIVITY.STALLS_MEM_ANY */,
+         "r40a6" /* EXE_ACTIVITY.BOUND_ON_STORES */},
+        {"cycles", "r40004a3" /* CYCLE_ACTIVITY.STALLS_TOTAL */, "r02a6" /* EXE_ACTIVITY.1_PORTS_UTIL */,
+         "r04a6" /* EXE_ACTIVITY.2_PORTS_UTIL */},
+    },
+};
+
+const TopDownModel kAmdModel{
+    TopDownVendor::Amd,
+    "AMD Zen pipeline utilization (6-wide)",
+    6,
+    {
+        {"cycles", "r1000001a0" /* de_no_dispatch_per_slot.no_ops_from_frontend */,
+         "r100001ea0" /* de_no_dispatch_per_slot.backend_stalls */, "rc1" /* ex_ret_ops */},
+        {"cycles", "r7aa" /* de_src_op_disp.all */, "ra2d6" /* ex_no_retire.load_not_complete */,
+         "r2d6" /* ex_no_retire.not_complete */},
+    },
+};
+
+const TopDownModel* detectModel() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return nullptr;
+    const bool intel = ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e; // "GenuineIntel"
+    const bool amd = ebx == 0x68747541 && edx == 0x69746e65 && ecx == 0x444d4163;   // "AuthenticAMD"
+    if ((!intel && !amd) || !__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return nullptr;
+    unsigned family = ((eax >> 8) & 0xf) + ((eax >> 20) & 0xff);
+    unsigned model = ((eax >> 4) & 0xf) | ((eax >> 12) & 0xf0);
+    if (intel) {
+        // The table only holds for Skylake-derived cores: Skylake client and server (Cascade and Cooper
+        // Lake), Kaby, Coffee, Whiskey and Comet Lake. Ice Lake is 5-wide, Golden Cove 6-wide with moved
+        // events, and hybrid E-cores use different ones, so those get no breakdown rather than a wrong one.
+        const unsigned skylakeModels[] = {0x4e, 0x5e, 0x55, 0x8e, 0x9e, 0xa5, 0xa6};
+        const bool skylake = family == 6 && std::find(std::begin(skylakeModels), std::end(skylakeModels), model) !=
+                                                std::end(skylakeModels);
+        return skylake ? &kIntelModel : nullptr;
+    }
+    // PMCx1A0 arrived with Zen 4; family 0x19 also covers Zen 3 (models 0x00-0x0f and 0x20-0x5f).
+    bool zen4 = family > 0x19 || (family == 0x19 && model >= 0x10 && (model < 0x20 || model >= 0x60));
+    return zen4 ? &kAmdModel : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+double clamp01(double value) {
+    return std::min(std::max(value, 0.0), 1.0);
+}
+
+void printFraction(const char* label, double value) {
+    std::cout << label << ": " << value * 100.0 << "%" << std::endl;
+}
+
+} // namespace
+
+const TopDownModel* topDownModel() {
+    static const TopDownModel* model = detectModel();
+    return model;
+}
+
+TopDownBreakdown computeTopDown(const TopDownModel& model, const std::vector<std::vector<uint64_t>>& totals,
+                                const std::vector<uint64_t>& repetitions) {
+    TopDownBreakdown breakdown;
+    breakdown.model = model.name;
+    if (totals.size() != model.groups.size() || repetitions.size() != model.groups.size()) return breakdown;
+    breakdown.repetitionsPerGroup = *std::min_element(repetitions.begin(), repetitions.end());
+
+    // Events per cycle of the group that counted them.
+    std::map<std::string, double> rate;
+    for (std::size_t g = 0; g < model.groups.size(); ++g) {
+        const auto& events = model.groups[g];
+        if (totals[g].size() != events.size() || totals[g][0] == 0) return breakdown;
+        const double cycles = static_cast<double>(totals[g][0]);
+        for (std::size_t e = 1; e < events.size(); ++e) rate[events[e]] = static_cast<double>(totals[g][e]) / cycles;
+    }
+
+    const double width = model.slotsPerCycle;
+    if (model.vendor == TopDownVendor::Intel) {
+        breakdown.frontendBound = clamp01(rate["r019c"] / width);
+        breakdown.badSpeculation = clamp01((rate["r010e"] - rate["r02c2"] + width * rate["r010d"]) / width);
+        breakdown.retiring = clamp01(rate["r02c2"] / width);
+        breakdown.backendBound =
+            clamp01(1.0 - breakdown.frontendBound - breakdown.badSpeculation - breakdown.retiring);
+
+        // Cycles with nothing delivered lose every slot to latency; the rest of frontend-bound is bandwidth.
+        breakdown.frontendLatency = std::min(rate["r0401019c"], breakdown.frontendBound);
+        breakdown.frontendBandwidth = breakdown.frontendBound - breakdown.frontendLatency;
+        const double mispredicts = rate["r00c5"];
+        const double clears = rate["r10401c3"];
+        const double mispredictShare = mispredicts + clears > 0.0 ? mispredicts / (mispredicts + clears) : 1.0;
+        breakdown.branchMispredicts = breakdown.badSpeculation * mispredictShare;
+        breakdown.machineClears = breakdown.badSpeculation - breakdown.branchMispredicts;
+
+        const double memoryCycles = rate["r140014a3"] + rate["r40a6"];
+        const double backendCycles = rate["r40004a3"] + rate["r02a6"] + (breakdown.retiring > 0.1 ? rate["r04a6"] : 0.0) + rate["r40a6"];
+        const double memoryShare = backendCycles > 0.0 ? clamp01(memoryCycles / backendCycles) : 0.0;
+        breakdown.memoryBound = breakdown.backendBound * memoryShare;
+        breakdown.coreBound = breakdown.backendBound - breakdown.memoryBound;
+    } else {
+        breakdown.frontendBound = clamp01(rate["r1000001a0"] / width);
+        breakdown.backendBound = clamp01(rate["r100001ea0"] / width);
+        breakdown.retiring = clamp01(rate["rc1"] / width);
+        breakdown.badSpeculation = clamp01((rate["r7aa"] - rate["rc1"]) / width);
+
+        const double notComplete = rate["r2d6"];
+        const double memoryShare = notComplete > 0.0 ? clamp01(rate["ra2d6"] / notComplete) : 0.0;
+        breakdown.memoryBound = breakdown.backendBound * memoryShare;
+        breakdown.coreBound = breakdown.backendBound - breakdown.memoryBound;
+    }
+    breakdown.valid = true;
+    return breakdown;
+}
+
+void printTopDown(const TopDownBreakdown& breakdown) {
+    if (!breakdown.valid) {
+        std::cout << "Top-Down: no data" << std::endl;
+        return;
+    }
+    std::cout << "Top-Down (" << breakdown.model << ", " << breakdown.repetitionsPerGroup << " calls per group):" << std::endl;
+    printFraction("Frontend Bound", breakdown.frontendBound);
+    if (breakdown.frontendLatency >= 0.0) {
+        printFraction("  Fetch Latency", breakdown.frontendLatency);
+        printFraction("  Fetch Bandwidth", breakdown.frontendBandwidth);
+    }
+    printFraction("Bad Speculation", breakdown.badSpeculation);
+    if (breakdown.branchMispredicts >= 0.0) {
+        printFraction("  Branch Mispredicts", breakdown.branchMispredicts);
+        printFraction("  Machine Clears", breakdown.machineClears);
+    }
+    printFraction("Backend Bound", breakdown.backendBound);
+    if (breakdown.memoryBound >= 0.0) {
+        printFraction("  Memory Bound", breakdown.memoryBound);
+        printFraction("  Core Bound", breakdown.coreBound);
+    }
+    printFraction("Retiring", breakdown.retiring);
+}
+
+TopDownCounters::TopDownCounters(const TopDownModel& model) {
+    for (const auto& events : model.groups) {
+        groups_.push_back(std::make_unique<PerfCounters>(events));
+    }
+    clear();
+    scratch_.assign(PerfCounters::kMaxGroupEvents, 0);
+}
+
+bool TopDownCounters::open() {
+    for (const auto& group : groups_) {
+        if (group->size() > PerfCounters::kMaxGroupEvents) {
+            error_ = "top-down group larger than one perf group";
+            return false;
+        }
+        if (!group->open(false)) {
+            error_ = group->error();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TopDownCounters::begin(int call) {
+    active_ = static_cast<std::size_t>(call) % groups_.size();
+    groups_[active_]->enable();
+    groups_[active_]->start();
+}
+
+void TopDownCounters::end() {
+    PerfCounters& group = *groups_[active_];
+    group.stop(scratch_.data());
+    group.disable();
+    for (std::size_t e = 0; e < group.size(); ++e) totals_[active_][e] += scratch_[e];
+    ++repetitions_[active_];
+}
+
+std::size_t TopDownCounters::groups() const {
+    return groups_.size();
+}
+
+const std::vector<std::vector<uint64_t>>& TopDownCounters::totals() const {
+    return totals_;
+}
+
+const std::vector<uint64_t>& TopDownCounters::repetitions() const {
+    return repetitions_;
+}
+
+const std::string& TopDownCounters::error() const {
+    return error_;
+}
+
+void TopDownCounters::clear() {
+    totals_.clear();
+    for (const auto& group : groups_) totals_.emplace_back(group->size(), 0);
+    repetitions_.assign(groups_.size(), 0);
+}
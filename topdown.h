@@ -0,0 +1,79 @@
+#ifndef TOPDOWN_H
+#define TOPDOWN_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+// Top-down microarchitecture analysis (level 1 and part of level 2) from raw core events.
+// Each group holds "cycles" plus at most three events and fits the PMU on its own; groups take turns,
+// one per timed call, so nothing is multiplexed, and every event becomes a per-cycle rate within its
+// own group before the rates from different groups are combined.
+
+enum class TopDownVendor {
+    Intel, // Skylake-derived cores (family 6), TMA events with 4 issue slots per cycle
+    Amd,   // Zen 4 and later PMCx1A0 dispatch-slot events, 6 slots per cycle
+};
+
+struct TopDownModel {
+    TopDownVendor vendor;
+    const char* name;
+    int slotsPerCycle;
+    std::vector<std::vector<std::string>> groups; // each group starts with "cycles"
+};
+
+// Detected once from CPUID; nullptr on CPUs without a model.
+const TopDownModel* topDownModel();
+
+// Fractions of issue slots; level-2 fields the model cannot split are negative.
+struct TopDownBreakdown {
+    bool valid = false;
+    std::string model;
+    uint64_t repetitionsPerGroup = 0; // fewest timed calls any group was counted over
+    double frontendBound = 0.0;
+    double badSpeculation = 0.0;
+    double backendBound = 0.0;
+    double retiring = 0.0;
+    double frontendLatency = -1.0;
+    double frontendBandwidth = -1.0;
+    double branchMispredicts = -1.0;
+    double machineClears = -1.0;
+    double memoryBound = -1.0;
+    double coreBound = -1.0;
+};
+
+// Per-group event totals (totals[g][e] for model.groups[g][e]) and calls counted per group.
+TopDownBreakdown computeTopDown(const TopDownModel& model, const std::vector<std::vector<uint64_t>>& totals,
+                                const std::vector<uint64_t>& repetitions);
+void printTopDown(const TopDownBreakdown& breakdown);
+
+// Per-worker counters for a model: every group is opened disabled and begin(call) turns on group
+// call % groups() for that call only.
+class TopDownCounters {
+public:
+    explicit TopDownCounters(const TopDownModel& model);
+
+    // Opens the counters for the calling thread. Returns false and sets error() on failure.
+    bool open();
+    void begin(int call);
+    void end();
+
+    std::size_t groups() const;
+    const std::vector<std::vector<uint64_t>>& totals() const;
+    const std::vector<uint64_t>& repetitions() const;
+    const std::string& error() const;
+    void clear();
+
+private:
+    std::vector<std::unique_ptr<PerfCounters>> groups_;
+    std::vector<std::vector<uint64_t>> totals_;
+    std::vector<uint64_t> repetitions_;
+    std::vector<uint64_t> scratch_;
+    std::size_t active_ = 0;
+    std::string error_;
+};
+
+#endif // TOPDOWN_H